@@ -1,76 +1,108 @@
-
 #ifndef _ARRAYDOC_H_
 #define _ARRAYDOC_H_
 
 #include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+// Include from libcds
+#include <static_sequence_wvtree_noptrs.h>
+#include <static_bitsequence_builder.h>
+#include <alphabet_mapper_none.h>
 
+/**
+ * Document array of the end-markers
+ *
+ * The read ids are stored twice: as a BlockArray for constant-time
+ * access(), which locate needs at every end-marker, and into a wavelet 
+ * tree, so that counting and reporting the values of a range that fall 
+ * into [min, max] take logarithmic time per reported value instead of 
+ * a linear scan.
+ */
 class ArrayDoc {
 public:
     ArrayDoc(BlockArray *input)
-        : data(input)
+        : ids(input), data(0)
     {
+        ulong n = input->getLength();
+        uint *symbols = new uint[n];
+        ulong buffer[DECODE_BLOCK];
+        for (ulong i = 0; i < n; i += DECODE_BLOCK)
+        {
+            ulong j = std::min(n, i + DECODE_BLOCK);
+            input->decode(i, j, buffer);
+            for (ulong k = i; k < j; ++k)
+                symbols[k] = buffer[k-i];
+        }
 
+        static_bitsequence_builder_brw32 bsb(16);
+        alphabet_mapper *am = new alphabet_mapper_none();
+        // Wavelet tree takes the ownership of symbols
+        data = new static_sequence_wvtree_noptrs(symbols, n, &bsb, am, true);
     }
     ArrayDoc(FILE *fp)
-        : data(0)
+        : ids(0), data(0)
     {
-        data = new BlockArray(fp);
+        ids = new BlockArray(fp);
+        data = static_sequence_wvtree_noptrs::load(fp);
+        if (!data)
+            throw std::runtime_error("ArrayDoc::ArrayDoc(): file read error.");
     }
 
     ~ArrayDoc()
     {
+        delete ids;
         delete data;
     }
 
     void save(FILE *fp)
     {
-        data->Save(fp);
+        ids->Save(fp);
+        if (data->save(fp))
+            throw std::runtime_error("ArrayDoc::save(): file write error.");
     }
-    
-    inline unsigned access(unsigned i)
+
+    inline unsigned access(unsigned i) const
     {
-        return (*data)[i];
+        return ids->get(i);
     }
-    inline std::vector<int> accessAll(unsigned i, unsigned j)
+    // Values of [i, j] in the order of the positions
+    std::vector<int> accessAll(unsigned i, unsigned j) const
     {
-        std::vector<int> res;
-        res.reserve(j-i+1);
-
-        for (; i <= j; ++i)
-            res.push_back((*data)[i]);
-
-        return res;
+        if (j < i)
+            return std::vector<int>();
+        std::vector<ulong> buffer(j-i+1);
+        ids->decode(i, j+1, &buffer[0]);
+        return std::vector<int>(buffer.begin(), buffer.end());
     }
-    
-    std::vector<int> access(unsigned i, unsigned j, unsigned min, unsigned max)
-    {
-        std::vector<int> res;
-        res.reserve(j-i+1);
 
-        for (; i <= j; ++i)
-            if ((*data)[i] >= min && (*data)[i] <= max)
-                res.push_back((*data)[i]);
-
-        return res;
+    // Values of [i, j] that fall into [min, max], in increasing order
+    std::vector<int> access(unsigned i, unsigned j, unsigned min, unsigned max) const
+    {
+        if (j < i || max < min)
+            return std::vector<int>();
+        return data->access(i, j, min, max);
     }
-    
 
-    unsigned count(unsigned i, unsigned j, unsigned min, unsigned max)
+    // Number of values of [i, j] that fall into [min, max]
+    unsigned count(unsigned i, unsigned j, unsigned min, unsigned max) const
     {
-        unsigned c = 0;
-        for (; i <= j; ++i)
-            if ((*data)[i] >= min && (*data)[i] <= max)
-                ++c;
-        return c;
+        if (j < i || max < min)
+            return 0;
+        return data->count(i, j, min, max);
     }
-    
+
     ulong size() const
     {
-        return data->spaceInBits()/8;
+        return ids->size() + data->size();
     }
-    
+
 private:
-    BlockArray *data;
+    // Read ids decoded from the input BlockArray at a time
+    static const ulong DECODE_BLOCK = 1024;
+
+    BlockArray *ids;
+    static_sequence_wvtree_noptrs *data;
 };
 
 #endif
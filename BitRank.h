@@ -44,6 +44,14 @@ public:
     ulong select0(ulong x) const; // gives the position of the x:th 0.
 
     bool IsBitSet(ulong i) const;
+
+    // Hint the cache to load the words needed by rank(i) and IsBitSet(i)
+    inline void prefetch(ulong i) const
+    {
+        __builtin_prefetch(data + (i >> wordShift));
+        __builtin_prefetch(Rs + ((i+1) >> 8));
+        __builtin_prefetch(Rb + ((i+1) >> wordShift));
+    }
 };
 
 #endif
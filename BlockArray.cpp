@@ -0,0 +1,108 @@
+#include "BlockArray.h"
+
+namespace
+{
+
+typedef void (*decoder_f)(ulong const *, ulong, ulong, ulong *);
+
+// Fields wider than MAX_UNALIGNED bits do not fit into one unaligned load
+const unsigned MAX_UNALIGNED = W - 7;
+
+/**
+ * Decoders of consecutive fields of a fixed width.
+ *
+ * Fields are stored as in Tools::GetField(): field i takes the bits 
+ * [i*Width, (i+1)*Width), LSB first, so on a little-endian machine a field
+ * is one unaligned 64-bit load, shift and mask. Every 8 fields take 
+ * exactly Width bytes, so a group of 8 fields starts at a byte boundary
+ * and the group is unrolled into loads at constant offsets with constant
+ * shifts. The widths 8, 16, 32 and 64 are plain arrays that the compiler
+ * vectorizes.
+ */
+template <unsigned Width>
+struct BlockArrayDecoder
+{
+    static inline ulong field(uchar const *bytes, ulong bit)
+    {
+        ulong w;
+        std::memcpy(&w, bytes + bit / 8, sizeof(ulong));
+        return (w >> (bit % 8)) & ((1lu << Width) - 1);
+    }
+
+    // Decodes the fields [i, j) into out
+    static void run(ulong const *data, ulong i, ulong j, ulong *out)
+    {
+        uchar const *bytes = reinterpret_cast<uchar const *>(data);
+        for (; i < j && i % 8; ++i)
+            *out++ = field(bytes, i * Width);
+        for (; i + 8 <= j; i += 8, out += 8)
+        {
+            uchar const *group = bytes + i / 8 * Width;
+#pragma GCC unroll 8
+            for (unsigned k = 0; k < 8; ++k)
+                out[k] = field(group, k * Width);
+        }
+        for (; i < j; ++i)
+            *out++ = field(bytes, i * Width);
+    }
+};
+
+template <class T>
+struct BlockArrayAlignedDecoder
+{
+    static void run(ulong const *data, ulong i, ulong j, ulong *out)
+    {
+        T const *p = reinterpret_cast<T const *>(data);
+        for (; i < j; ++i)
+            *out++ = p[i];
+    }
+};
+
+template <> struct BlockArrayDecoder<8> : BlockArrayAlignedDecoder<uchar> { };
+template <> struct BlockArrayDecoder<16> : BlockArrayAlignedDecoder<unsigned short> { };
+template <> struct BlockArrayDecoder<32> : BlockArrayAlignedDecoder<unsigned> { };
+
+template <>
+struct BlockArrayDecoder<0>
+{
+    static void run(ulong const *, ulong i, ulong j, ulong *out)
+    {
+        for (; i < j; ++i)
+            *out++ = 0;
+    }
+};
+
+/**
+ * Picks BlockArrayDecoder<width> for a width given at run time
+ */
+template <unsigned Width>
+struct BlockArrayDecoderTable
+{
+    static decoder_f get(unsigned width)
+    {
+        return width == Width ? &BlockArrayDecoder<Width>::run 
+            : BlockArrayDecoderTable<Width-1>::get(width);
+    }
+};
+
+template <>
+struct BlockArrayDecoderTable<0>
+{
+    static decoder_f get(unsigned)
+    {
+        return &BlockArrayDecoder<0>::run;
+    }
+};
+
+} // namespace
+
+BlockArray::decoder_f BlockArray::decoderFor(unsigned width)
+{
+    if (width == W)
+        return &BlockArrayAlignedDecoder<ulong>::run;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (width <= MAX_UNALIGNED)
+        return BlockArrayDecoderTable<MAX_UNALIGNED>::get(width);
+#endif
+    return 0; // decode() reads one field at a time
+}
@@ -3,7 +3,18 @@
 #include "Tools.h"
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
 
+/**
+ * Array of n fields of blockLength bits.
+ *
+ * Reads are specialised for the field width when the array is built or
+ * loaded: widths 8, 16, 32 and 64 are read as aligned integers, other
+ * widths up to 57 bits by one unaligned 64-bit load, shift and mask, and 
+ * wider fields by Tools::GetField(). decode() extracts a range of fields
+ * at once, see BlockArray.cpp. The data has one extra word of padding 
+ * for the unaligned loads; the file format is unchanged.
+ */
 class BlockArray
 {
 private:
@@ -11,12 +22,47 @@ private:
     ulong n;
     ulong index;
     ulong blockLength;
+    // Read path for the field width
+    enum access_kind { ACCESS_8, ACCESS_16, ACCESS_32, ACCESS_64, ACCESS_UNALIGNED, ACCESS_GENERIC };
+    access_kind kind;
+    ulong mask;
+    // Bulk decoder for the field width, see BlockArray.cpp; null if 
+    // the fields are decoded one at a time
+    typedef void (*decoder_f)(ulong const *, ulong, ulong, ulong *);
+    decoder_f decoder;
+    static decoder_f decoderFor(unsigned);
+
+    ulong words() const
+    {
+        return n*blockLength/W +1;
+    }
+
+    // Allocates the data and the padding word
+    void allocate()
+    {
+        data = new ulong[words() + 1];
+        data[words()] = 0;
+        mask = blockLength >= W ? ~0lu : (1lu << blockLength) - 1;
+        decoder = decoderFor(blockLength);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        switch (blockLength)
+        {
+        case 8:  kind = ACCESS_8; break;
+        case 16: kind = ACCESS_16; break;
+        case 32: kind = ACCESS_32; break;
+        case 64: kind = ACCESS_64; break;
+        default: kind = blockLength <= W - 7 ? ACCESS_UNALIGNED : ACCESS_GENERIC;
+        }
+#else
+        kind = blockLength == W ? ACCESS_64 : ACCESS_GENERIC;
+#endif
+    }
 public:
     BlockArray(ulong len, ulong blockLen) {
        n = len;
        blockLength = blockLen;
-       data = new ulong[n*blockLength/W +1];
-       for (ulong i = 0; i < n*blockLength/W +1; ++i)
+       allocate();
+       for (ulong i = 0; i < words(); ++i)
            data[i] = 0;
     }
     ~BlockArray() {
@@ -34,15 +80,48 @@ public:
 
     BlockArray& operator=(const BlockArray& ba) {
        if (this == &ba) return *this;
-       ulong value = Tools::GetField(ba.data, ba.blockLength, ba.index);
-       Tools::SetField(data,blockLength,index,value);
+       Tools::SetField(data,blockLength,index,ba.get(ba.index));
        return *this;
     }  
         
     operator ulong() {
-       return Tools::GetField(data,blockLength,index);
+       return get(index);
+    }
+
+    // Field i
+    inline ulong get(ulong i) const
+    {
+        switch (kind)
+        {
+        case ACCESS_8:  return reinterpret_cast<uchar const *>(data)[i];
+        case ACCESS_16: return reinterpret_cast<unsigned short const *>(data)[i];
+        case ACCESS_32: return reinterpret_cast<unsigned const *>(data)[i];
+        case ACCESS_64: return data[i];
+        case ACCESS_UNALIGNED:
+        {
+            ulong bit = i * blockLength, w;
+            std::memcpy(&w, reinterpret_cast<uchar const *>(data) + bit / 8, sizeof(ulong));
+            return (w >> (bit % 8)) & mask;
+        }
+        default: return Tools::GetField(data,blockLength,i);
+        }
+    }
+
+    // Decodes the fields [i, j) into out[0..j-i-1]
+    inline void decode(ulong i, ulong j, ulong *out) const
+    {
+        if (decoder)
+            decoder(data, i, j, out);
+        else
+            for (; i < j; ++i)
+                *out++ = get(i);
     }
     
+    ulong getLength() const
+    {
+        return n;
+    }
+
     ulong spaceInBits() const 
     {
         return n*blockLength+W; // plus 4 ulong's
@@ -65,7 +144,7 @@ public:
         if (std::fwrite(&(this->blockLength), sizeof(ulong), 1, file) != 1)
             throw std::runtime_error("BlockArray::Save(): file write error (blockLength).");
     
-        if (std::fwrite(this->data, sizeof(ulong), n*blockLength/W+1, file) != n*blockLength/W+1)
+        if (std::fwrite(this->data, sizeof(ulong), words(), file) != words())
             throw std::runtime_error("BlockArray::Save(): file write error (data).");
     }
 
@@ -78,12 +157,13 @@ public:
             throw std::runtime_error("BlockArray::Load(): file read error (n).");
         if (std::fread(&(this->blockLength), sizeof(ulong), 1, file) != 1)
             throw std::runtime_error("BlockArray::Load(): file read error (blockLength).");
+        if (blockLength > W)
+            throw std::runtime_error("BlockArray::Load(): invalid field width.");
 
-        data = new ulong[n*blockLength/W+1];
-        if (std::fread(this->data, sizeof(ulong), n*blockLength/W+1, file) != n*blockLength/W+1)
+        allocate();
+        if (std::fread(this->data, sizeof(ulong), words(), file) != words())
             throw std::runtime_error("BlockArray::Load(): file read error (data).");
     }
 };
 
 #endif
-
@@ -25,6 +25,10 @@
 #include <stdexcept>
 #include <cassert>
 #include <cstring> // For strlen()
+#include <chrono>
+#include <algorithm>
+#include <queue>
+#include <random>
 using std::vector;
 using std::pair;
 using std::make_pair;
@@ -34,7 +38,7 @@ using std::map;
 const char CGkArray::ALPHABET_SHIFTED[] = {1, 'A'+1, 'C'+1, 'G'+1, 'N'+1, 'T'+1};
 
 // Save file version info
-const uchar CGkArray::versionFlag = 17;
+const uchar CGkArray::versionFlag = 25;
 
 /** sets bit p in e */
 #define bitset32(e,p) ((e)[(p)/32] |= (1<<((p)%32)))
@@ -61,6 +65,7 @@ uchar * CGkArray::getRead(unsigned readno) const
     text[--l] = c;
     while (l > 0)
     {
+        QueryStats::lfSteps(1);
         i = C[c]+alphabetrank_i_tmp-1;
         c = alphabetrank->access(i, alphabetrank_i_tmp);
         text[--l] = c;  
@@ -109,22 +114,204 @@ uchar * CGkArray::getSuffix(ulong dest, unsigned l) const
  * Input: k-mer
  * Output: Suffix array range
  */
-CGkArray::sa_range CGkArray::kmerToSARange(uchar const *kmer) const
+template <class Pattern>
+CGkArray::sa_range CGkArray::patternToSARange(Pattern const &p, unsigned l) const
 {
     ulong smin = 0;
     ulong smax = n-1;
-    unsigned i = gk;
-    while (i > 0)
+    while (l > 0)
     {
-        smin = LF(kmer[i-1], smin-1);
-        smax = LF(kmer[i-1], smax)-1;
-        if (smin > smax)
+        if (!backwardStep(p[l-1], smin, smax))
             return make_pair(1,0); // Not found
-        --i;
+        --l;
     }
     return make_pair(smin, smax);
 }
 
+CGkArray::sa_range CGkArray::kmerToSARange(uchar const *kmer, unsigned k) const
+{
+    return patternToSARange(kmer, layer(k).k);
+}
+
+/**
+ * Packed k-mers
+ */
+CGkArray::packed_kmer CGkArray::packKmer(uchar const *kmer, unsigned k, packed_kmer &nmask)
+{
+    checkPackedLength(k);
+    packed_kmer packed = 0;
+    nmask = 0;
+    for (unsigned i = 0; i < k; ++i)
+    {
+        packed <<= 2;
+        nmask <<= 2;
+        switch (kmer[i])
+        {
+        case 'A': break;
+        case 'C': packed |= 1; break;
+        case 'G': packed |= 2; break;
+        case 'T': packed |= 3; break;
+        default:  nmask |= 3; break;
+        }
+    }
+    return packed;
+}
+
+void CGkArray::unpackKmer(packed_kmer kmer, packed_kmer nmask, unsigned k, uchar *result)
+{
+    checkPackedLength(k);
+    PackedKmerSymbols symbols(kmer, nmask, k);
+    for (unsigned i = 0; i < k; ++i)
+        result[i] = "ACGTN"[symbols[i].code];
+    result[k] = '\0';
+}
+
+CGkArray::packed_sequence::packed_sequence(uchar const *pattern)
+    : bases(), nmask(), length(strlen((char const *)pattern))
+{
+    bases.resize((length + 31) / 32, 0);
+    for (ulong i = 0; i < length; ++i)
+    {
+        ulong code = 0;
+        switch (pattern[i])
+        {
+        case 'A': break;
+        case 'C': code = 1; break;
+        case 'G': code = 2; break;
+        case 'T': code = 3; break;
+        default:
+            if (nmask.empty())
+                nmask.resize((length + 63) / 64, 0);
+            nmask[i/64] |= 1lu << (i%64);
+        }
+        bases[i/32] |= code << (62 - 2*(i%32));
+    }
+}
+
+CGkArray::sa_range CGkArray::packedKmerToSARange(packed_kmer kmer, packed_kmer nmask, unsigned k) const
+{
+    unsigned l = layer(k).k;
+    checkPackedLength(l);
+    return patternToSARange(PackedKmerSymbols(kmer, nmask, l), l);
+}
+
+void CGkArray::packedKmerToSARange(vector<packed_kmer> const &kmers, vector<sa_range> &result, unsigned k) const
+{
+    packedKmerToSARange(kmers, vector<packed_kmer>(), result, k);
+}
+
+/**
+ * Batched search of packed k-mers
+ *
+ * Each backward search step waits for the rank of the previous step,
+ * so the searches of a group of k-mers advance in lockstep, one step
+ * of each k-mer per round, to keep several memory accesses in flight.
+ */
+void CGkArray::packedKmerToSARange(vector<packed_kmer> const &kmers, vector<packed_kmer> const &nmasks,
+                                   vector<sa_range> &result, unsigned k) const
+{
+    const ulong groupSize = 8;
+    unsigned l = layer(k).k;
+    checkPackedLength(l);
+    result.resize(kmers.size());
+    for (ulong g = 0; g < kmers.size(); g += groupSize)
+    {
+        ulong size = std::min(groupSize, kmers.size() - g);
+        ulong sp[groupSize], ep[groupSize];
+        bool found[groupSize];
+        for (ulong j = 0; j < size; ++j)
+        {
+            sp[j] = 0;
+            ep[j] = n-1;
+            found[j] = true;
+        }
+        ulong nfound = size;
+        for (unsigned i = l; i > 0 && nfound; --i)
+            for (ulong j = 0; j < size; ++j)
+            {
+                if (!found[j])
+                    continue;
+                PackedKmerSymbols symbols(kmers[g+j], nmasks.empty() ? 0 : nmasks[g+j], l);
+                if (!backwardStep(symbols[i-1], sp[j], ep[j]))
+                {
+                    found[j] = false;
+                    --nfound;
+                }
+            }
+        for (ulong j = 0; j < size; ++j)
+            result[g+j] = found[j] ? make_pair(sp[j], ep[j]) : make_pair(1lu, 0lu);
+    }
+}
+
+CGkArray::approximate_vector CGkArray::kmerToSARanges(uchar const *kmer, unsigned d, unsigned k) const
+{
+    approximate_vector result;
+    vector<unsigned> mismatches;
+    mismatches.reserve(d);
+    approximateSearch(kmer, layer(k).k, 0, n-1, d, mismatches, result);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void CGkArray::kmerToSARanges(vector<uchar const *> const &kmers, unsigned d, 
+                              vector<approximate_vector> &result, unsigned k) const
+{
+    k = layer(k).k;
+    result.resize(kmers.size());
+    vector<unsigned> mismatches;
+    mismatches.reserve(d);
+    for (unsigned j = 0; j < kmers.size(); ++j)
+    {
+        result[j].clear();
+        approximateSearch(kmers[j], k, 0, n-1, d, mismatches, result[j]);
+        std::sort(result[j].begin(), result[j].end());
+    }
+}
+
+void CGkArray::approximateSearch(uchar const *kmer, unsigned i, ulong sp, ulong ep, unsigned d,
+                                 vector<unsigned> &mismatches, approximate_vector &result) const
+{
+    static const uchar bases[] = {'A', 'C', 'G', 'T'};
+    if (d == 0)
+    {
+        // No mismatches left: plain backward search
+        for (; i > 0; --i)
+        {
+            sp = LF(kmer[i-1], sp-1);
+            ep = LF(kmer[i-1], ep)-1;
+            if (sp > ep)
+                return; // Not found
+        }
+    }
+    if (i == 0)
+    {
+        // Mismatches were found in decreasing order
+        result.push_back(make_pair(make_pair(sp, ep), 
+                                   vector<unsigned>(mismatches.rbegin(), mismatches.rend())));
+        return;
+    }
+
+    --i;
+    for (unsigned j = 0; j < sizeof(bases); ++j)
+    {
+        uchar c = bases[j];
+        if (c == kmer[i])
+            continue;
+        ulong nsp = LF(c, sp-1);
+        ulong nep = LF(c, ep)-1;
+        if (nsp > nep)
+            continue; // Prune
+        mismatches.push_back(i);
+        approximateSearch(kmer, i, nsp, nep, d-1, mismatches, result);
+        mismatches.pop_back();
+    }
+    // Match
+    ulong nsp = LF(kmer[i], sp-1);
+    ulong nep = LF(kmer[i], ep)-1;
+    if (nsp <= nep)
+        approximateSearch(kmer, i, nsp, nep, d, mismatches, result);
+}
+
 /**
  * Move left operation gives an efficient way to step over each k-mer in a read.
  *
@@ -135,15 +322,17 @@ CGkArray::sa_range CGkArray::kmerToSARange(uchar const *kmer) const
  * Input: <internal value>, use initMoveLeft() to initialize.
  * Output: Suffix array range of the preceeding read position
  */
-CGkArray::sa_range CGkArray::moveLeft(ulong &i) const
+CGkArray::sa_range CGkArray::moveLeft(ulong &i, unsigned k) const
 {
+    static_bitsequence *Blcp = layer(k).Blcp;
     ulong alphabetrank_i_tmp = 0;
     uchar c  = alphabetrank->access(i, alphabetrank_i_tmp);
     if (c == '\0')
         return make_pair(1,0); // Cannot move left.
     
+    QueryStats::lfSteps(1);
     i = C[c]+alphabetrank_i_tmp-1;
-    return make_pair(Blcp->prev(i), Blcp->next(i+1)-1);
+    return make_pair(prevOne(Blcp, i), nextOne(Blcp, i+1)-1);
 }
 
 /**
@@ -157,8 +346,10 @@ CGkArray::sa_range CGkArray::moveLeft(ulong &i) const
  *         Range can be empty if the k-mer is not found in the index.
  *         After the last step, subsequent calls return an empty SA range.
  */
-CGkArray::sa_range CGkArray::moveLeft(CGkArray::internal_pointer &intp, uchar const *pattern) const
+template <class Sequence>
+CGkArray::sa_range CGkArray::moveLeftPattern(CGkArray::internal_pointer &intp, Sequence const &pattern, unsigned k) const
 {
+    KmerLayer const &kl = layer(k);
     sa_range &sar = intp.first;
     unsigned &pos = intp.second;
     if (pos == 0)
@@ -169,23 +360,36 @@ CGkArray::sa_range CGkArray::moveLeft(CGkArray::internal_pointer &intp, uchar co
     { 
         // Previous k-mer was not found in the index:
         // restarting the search from the new pos
-        sar = kmerToSARange(pattern + pos);
+        sar = patternToSARange(OffsetSymbols<Sequence>(pattern, pos), kl.k);
     }
     else
     {
         // Previous SA range was valid:
         // update with the next symbol
-        sar.first  = LF(pattern[pos], sar.first-1);
-        sar.second = LF(pattern[pos], sar.second)-1;
-        if (sar.first > sar.second)
-            return make_pair(1,0); // The k-mer at position pos was not found
-        // Truncate the search to k symbols
-        sar.first  = Blcp->prev(sar.first);
-        sar.second = Blcp->next(sar.second + 1) - 1;
+        if (!backwardStep(OffsetSymbols<Sequence>(pattern, pos)[0], sar.first, sar.second))
+            // The (k+1)-mer was not found, but the k-mer at 
+            // position pos may still occur: restart the search
+            sar = patternToSARange(OffsetSymbols<Sequence>(pattern, pos), kl.k);
+        else
+        {
+            // Truncate the search to k symbols
+            sar.first  = prevOne(kl.Blcp, sar.first);
+            sar.second = nextOne(kl.Blcp, sar.second + 1) - 1;
+        }
     }
     return sar;
 }
 
+CGkArray::sa_range CGkArray::moveLeft(CGkArray::internal_pointer &intp, uchar const *pattern, unsigned k) const
+{
+    return moveLeftPattern(intp, pattern, k);
+}
+
+CGkArray::sa_range CGkArray::moveLeft(CGkArray::internal_pointer &intp, packed_sequence const &pattern, unsigned k) const
+{
+    return moveLeftPattern(intp, pattern, k);
+}
+
 /**
  * Initialize move left
  *
@@ -195,16 +399,17 @@ CGkArray::sa_range CGkArray::moveLeft(CGkArray::internal_pointer &intp, uchar co
  * Input: Read number
  * Output: <internal value>
  */
-ulong CGkArray::initMoveLeft(unsigned j) const
+ulong CGkArray::initMoveLeft(unsigned j, unsigned k) const
 {
     ulong i = j; // Position of the '\0' terminator of read j
     
     // Move left over k-1 symbols
-    unsigned k = gk - 1;
+    unsigned steps = layer(k).k - 1;
     ulong alphabetrank_i_tmp = 0;
     uchar c  = alphabetrank->access(i, alphabetrank_i_tmp);
-    while (k--) 
+    while (steps--) 
     {
+        QueryStats::lfSteps(1);
         i = C[c]+alphabetrank_i_tmp-1;
         c = alphabetrank->access(i, alphabetrank_i_tmp);
     }
@@ -220,68 +425,556 @@ ulong CGkArray::initMoveLeft(unsigned j) const
  * Input: Arbitrary string, assuming '\0'-terminated
  * Output: <internal pointer> that points to the last k-mer of the given pattern.
  */
-CGkArray::internal_pointer CGkArray::initMoveLeft(uchar const *pattern) const
+CGkArray::internal_pointer CGkArray::initMoveLeft(uchar const *pattern, unsigned k) const
 {
-    unsigned pos = strlen((char const *)pattern) - gk + 1;
-    sa_range sar = kmerToSARange(pattern + pos);
+    unsigned pos = strlen((char const *)pattern) - layer(k).k + 1;
+    sa_range sar = kmerToSARange(pattern + pos, k);
     return make_pair(sar, pos);
 }
 
-CGkArray::position_vector CGkArray::reportOccs(sa_range const &range) const
+CGkArray::internal_pointer CGkArray::initMoveLeft(packed_sequence const &pattern, unsigned k) const
+{
+    unsigned l = layer(k).k;
+    unsigned pos = pattern.length - l + 1;
+    sa_range sar = patternToSARange(OffsetSymbols<packed_sequence>(pattern, pos), l);
+    return make_pair(sar, pos);
+}
+
+/**
+ * Bidirectional search
+ *
+ * Extending the pattern in one direction is a backward step in the 
+ * corresponding index. The range in the other index is a subrange of the 
+ * old one: it skips the occurrences followed (or preceded) by a smaller symbol.
+ */
+CGkArray::bidirectional_range CGkArray::patternToBidirectionalRange(uchar const *pattern, unsigned l) const
+{
+    bidirectional_range br = make_pair(make_pair(0, n-1), make_pair(0, n-1));
+    for (unsigned i = 0; i < l && br.first.first <= br.first.second; ++i)
+        br = extendRight(br, pattern[i]);
+    return br;
+}
+
+CGkArray::bidirectional_range CGkArray::extendLeft(bidirectional_range const &br, uchar c) const
+{
+    sa_range const &f = br.first;
+    sa_range const &r = br.second;
+    if (f.first > f.second)
+        return br;
+    ulong sp = LF(c, f.first-1);
+    ulong ep = LF(c, f.second)-1;
+    if (sp > ep)
+        return make_pair(make_pair(1,0), make_pair(1,0));
+    ulong rsp = r.first + countSmaller(alphabetrank, c, f.first, f.second);
+    return make_pair(make_pair(sp, ep), make_pair(rsp, rsp + ep - sp));
+}
+
+CGkArray::bidirectional_range CGkArray::extendRight(bidirectional_range const &br, uchar c) const
+{
+    if (!isBidirectional())
+        throw std::runtime_error("CGkArray: index was not built with the reverse BWT.");
+    sa_range const &f = br.first;
+    sa_range const &r = br.second;
+    if (f.first > f.second)
+        return br;
+    ulong sp = LFRev(c, r.first-1);
+    ulong ep = LFRev(c, r.second)-1;
+    if (sp > ep)
+        return make_pair(make_pair(1,0), make_pair(1,0));
+    ulong fsp = f.first + countSmaller(alphabetrankRev, c, r.first, r.second);
+    return make_pair(make_pair(fsp, fsp + ep - sp), make_pair(sp, ep));
+}
+
+/**
+ * Move right operation for arbitrary patterns
+ *
+ * The k-mer xQ is extended to the (k+1)-mer xQc, and then truncated 
+ * to Qc: in the reverse index by B_lcp of the reverse index, and in the 
+ * forward index by taking the successor (psi) of an occurrence of xQc.
+ */
+CGkArray::sa_range CGkArray::moveRight(bidirectional_pointer &bp, uchar const *pattern, unsigned k) const
+{
+    if (!isBidirectional())
+        throw std::runtime_error("CGkArray: index was not built with the reverse BWT.");
+    KmerLayer const &kl = layer(k);
+    bidirectional_range &br = bp.first;
+    unsigned &pos = bp.second;
+    if (br.first.first > br.first.second)
+    {
+        // No valid range: restart the search from pos
+        for (unsigned i = 0; i < kl.k; ++i)
+            if (pattern[pos+i] == '\0')
+                return make_pair(1,0); // End of pattern
+        br = patternToBidirectionalRange(pattern + pos, kl.k);
+        ++pos;
+        return br.first;
+    }
+
+    uchar c = pattern[pos+kl.k-1];
+    if (c == '\0')
+        return make_pair(1,0); // End of pattern
+    bidirectional_range ext = extendRight(br, c);
+    if (ext.first.first > ext.first.second)
+        // The (k+1)-mer was not found, but the k-mer may still occur
+        br = patternToBidirectionalRange(pattern + pos, kl.k);
+    else
+    {
+        uchar x = pattern[pos-1];
+        ulong y = alphabetrank->select(x, ext.first.first - C[x] + 1);
+        br.first = make_pair(prevOne(kl.Blcp, y), nextOne(kl.Blcp, y+1)-1);
+        y = ext.second.first;
+        br.second = make_pair(prevOne(kl.BlcpRev, y), nextOne(kl.BlcpRev, y+1)-1);
+    }
+    ++pos;
+    return br.first;
+}
+
+/**
+ * Canonical k-mer queries
+ */
+unsigned CGkArray::countReadsCanonical(uchar const *kmer, unsigned k) const
+{
+    k = layer(k).k;
+    unsigned count = countReads(kmerToSARange(kmer, k), k);
+    if (bothStrands)
+        return count;
+    uchar *rc = new uchar[k];
+    Tools::ReverseComplement(rc, kmer, k);
+    count += countReads(kmerToSARange(rc, k), k);
+    delete [] rc;
+    return count;
+}
+
+CGkArray::position_vector CGkArray::reportReadsCanonical(uchar const *kmer, unsigned k) const
+{
+    k = layer(k).k;
+    position_vector pv = reportReads(kmerToSARange(kmer, k), k);
+    if (bothStrands)
+    {
+        // Map the reverse complemented reads back to the forward strand
+        unsigned h = numberOfTexts / 2;
+        for (position_vector::iterator it = pv.begin(); it != pv.end(); ++it)
+            if (it->first >= h)
+            {
+                it->first -= h;
+                it->second = readBoundary->length(it->first) - 1 - k - it->second;
+            }
+        return pv;
+    }
+    uchar *rc = new uchar[k];
+    Tools::ReverseComplement(rc, kmer, k);
+    position_vector pv2 = reportReads(kmerToSARange(rc, k), k);
+    delete [] rc;
+    pv.insert(pv.end(), pv2.begin(), pv2.end());
+    return pv;
+}
+
+void CGkArray::coverage(unsigned readno, vector<unsigned> &profile, unsigned k) const
+{
+    k = layer(k).k;
+    profile.clear();
+    ulong l = readBoundary->length(readno) - 1;
+    if (l < k)
+        return;
+    ulong readpos = l - k + 1;
+    profile.resize(readpos);
+    ulong tmp = initMoveLeft(readno, k);
+    sa_range sar = moveLeft(tmp, k);
+    while (sar.first <= sar.second && readpos)
+    {
+        profile[--readpos] = countReads(sar, k);
+        sar = moveLeft(tmp, k);
+    }
+}
+
+void CGkArray::coverageCanonical(unsigned readno, vector<unsigned> &profile, unsigned k) const
+{
+    k = layer(k).k;
+    // Forward strand (covers both strands if they are indexed)
+    coverage(readno, profile, k);
+    if (bothStrands || profile.empty())
+        return;
+    ulong l = readBoundary->length(readno) - 1;
+
+    // Reverse complemented read: its k-mer at position j 
+    // is the reverse complement of the k-mer at l - k - j.
+    uchar *read = getRead(readno);
+    uchar *rc = new uchar[l+1];
+    Tools::ReverseComplement(rc, read, l);
+    rc[l] = '\0';
+    delete [] read;
+    internal_pointer ip = initMoveLeft(rc, k);
+    for (ulong j = l - k + 1; j > 0; --j)
+    {
+        sa_range sar = moveLeft(ip, rc, k); // k-mer at position j-1
+        if (sar.first <= sar.second)
+            profile[l - k - (j - 1)] += countReads(sar, k);
+    }
+    delete [] rc;
+}
+
+/**
+ * Batch conversion from text positions to pairs of <read number, read position>
+ */
+CGkArray::position_vector CGkArray::textPosToReadPos(vector<ulong> const &tpos) const
 {
-    ulong sp = range.first;
-    ulong ep = range.second;
     position_vector result;
-    result.reserve(ep-sp+1);
-        
-    ulong tmp_rank_c = 0; // Cache rank value of c.
-    for (; sp <= ep; ++sp)
-    {
-        ulong i = sp;
-        ulong dist = 0;
-        uchar c = alphabetrank->access(i, tmp_rank_c);
-        while (c != '\0' && !sampled->access(i))
+    result.reserve(tpos.size());
+    unsigned read = 0;
+    ulong readStart = 1, readEnd = 0; // Empty interval
+    for (vector<ulong>::const_iterator it = tpos.begin(); it != tpos.end(); ++it)
+    {
+        if (*it < readStart || *it >= readEnd)
         {
-            i = C[c]+tmp_rank_c-1; //alphabetrank->rank(c,i)-1;
-            c = alphabetrank->access(i, tmp_rank_c);
-            ++ dist;
+            read = readBoundary->read(*it);
+            readStart = readBoundary->start(read);
+            readEnd = readBoundary->start(read+1);
         }
-        if (c == '\0')
+        result.push_back(make_pair(read, *it - readStart));
+    }
+    return result;
+}
+
+/**
+ * Batch conversion from pairs of <read number, read position> to text positions
+ */
+vector<ulong> CGkArray::readPosToTextPos(position_vector const &rpos) const
+{
+    vector<ulong> result;
+    result.reserve(rpos.size());
+    unsigned read = 0;
+    ulong readStart = readBoundary->start(0);
+    for (position_vector::const_iterator it = rpos.begin(); it != rpos.end(); ++it)
+    {
+        if (it->first != read)
         {
-            // Rank among the end-markers in BWT
-            unsigned docId = Doc->access(tmp_rank_c-1);
-            result.push_back(make_pair(docId, dist)); 
+            read = it->first;
+            readStart = readBoundary->start(read);
         }
-        else
-            result.push_back(textPosToReadPos((*suffixes)[sampled->rank1(i)-1] + dist));
+        result.push_back(readStart + it->second);
     }
     return result;
 }
 
+CGkArray::position_vector CGkArray::reportReads(sa_range const &range, unsigned minRead, unsigned maxRead, unsigned k) const
+{
+    KmerLayer const &kl = layer(k);
+    position_vector pv;
+    if (range.first > range.second || minRead > maxRead)
+        return pv;
+    if (minRead == 0 && maxRead >= numberOfTexts - 1)
+        return reportReads(kl, range.first, range.second);
+
+    // The 1-bits of B_last in the range are [i, j) in Dlast
+    ulong i = range.first ? kl.Blast->rank1(range.first-1) : 0;
+    ulong j = kl.Blast->rank1(range.second);
+    if (i == j)
+        return pv;
+    ulong count = kl.Dlast ? kl.Dlast->rangeCount(i, j-1, minRead, maxRead) : j - i;
+    if (count == 0)
+        return pv;
+    if (!kl.Dlast || j - i < DLAST_REPORT_RATIO * count)
+    {
+        // Most of the reads are in the range: locate all and filter
+        pv = reportReads(kl, range.first, range.second);
+        position_vector::iterator it = pv.begin();
+        for (position_vector::const_iterator jt = pv.begin(); jt != pv.end(); ++jt)
+            if (jt->first >= minRead && jt->first <= maxRead)
+                *it++ = *jt;
+        pv.erase(it, pv.end());
+        return pv;
+    }
+
+    // Locate only the 1-bits of the reads in the range
+    std::vector<int> reads = kl.Dlast->access(i, j-1, minRead, maxRead);
+    std::vector<ulong> sapos;
+    sapos.reserve(count);
+    for (std::vector<int>::const_iterator it = reads.begin(); it != reads.end(); ++it)
+    {
+        uint before = i ? kl.Dlast->rank(*it, i-1) : 0;
+        uint last = kl.Dlast->rank(*it, j-1);
+        for (uint m = before + 1; m <= last; ++m)
+            sapos.push_back(kl.Blast->select1(kl.Dlast->select(*it, m) + 1));
+    }
+    std::sort(sapos.begin(), sapos.end());
+    locate(sapos, pv);
+    return pv;
+}
+
+unsigned CGkArray::countReads(sa_range const &range, unsigned minRead, unsigned maxRead, unsigned k) const
+{
+    KmerLayer const &kl = layer(k);
+    if (range.first > range.second || minRead > maxRead)
+        return 0;
+    if (minRead == 0 && maxRead >= numberOfTexts - 1)
+        return countReads(kl, range.first, range.second);
+    if (!kl.Dlast)
+        return reportReads(range, minRead, maxRead, k).size();
+    ulong i = range.first ? kl.Blast->rank1(range.first-1) : 0;
+    ulong j = kl.Blast->rank1(range.second);
+    if (i == j)
+        return 0;
+    return kl.Dlast->rangeCount(i, j-1, minRead, maxRead);
+}
+
+void CGkArray::enumerateKmers(ulong sp, ulong ep, kmer_class_vector &result, unsigned k) const
+{
+    KmerLayer const &kl = layer(k);
+    if (ep >= n)
+        ep = n-1;
+    // B_lcp has a 1-bit at n, so next() is always defined
+    ulong i = nextOne(kl.Blcp, sp);
+    while (i <= ep)
+    {
+        ulong j = nextOne(kl.Blcp, i+1);
+        // Only the runs of valid k-mers have a 1-bit in B_last
+        unsigned reads = countReads(kl, i, j-1);
+        if (reads)
+            result.push_back(make_pair(make_pair(i, j-1), reads));
+        i = j;
+    }
+}
+
+namespace
+{
+    // Ranks the k-mer classes for topKmers(): higher frequency first, then SA order
+    class KmerClassBetter
+    {
+    public:
+        KmerClassBetter(CGkArray::kmer_order order_)
+            : order(order_)
+        { }
+        ulong key(CGkArray::kmer_class const &a) const
+        {
+            return order == CGkArray::by_reads ? a.second : a.first.second - a.first.first + 1;
+        }
+        bool operator()(CGkArray::kmer_class const &a, CGkArray::kmer_class const &b) const
+        {
+            ulong ka = key(a), kb = key(b);
+            return ka > kb || (ka == kb && a.first.first < b.first.first);
+        }
+    private:
+        CGkArray::kmer_order order;
+    };
+}
+
+CGkArray::kmer_class_vector CGkArray::topKmers(unsigned N, kmer_order order, unsigned k, ulong sp, ulong ep) const
+{
+    KmerLayer const &kl = layer(k);
+    KmerClassBetter better(order);
+    // Worst k-mer on top
+    std::priority_queue<kmer_class, kmer_class_vector, KmerClassBetter> heap(better);
+    if (ep >= n)
+        ep = n-1;
+    ulong i = N ? nextOne(kl.Blcp, sp) : n;
+    while (i <= ep)
+    {
+        ulong j = nextOne(kl.Blcp, i+1);
+        // Runs are visited in SA order, so a tie with the worst k-mer loses
+        if (order == by_occs && heap.size() == N && j - i <= better.key(heap.top()))
+        {
+            i = j;
+            continue;
+        }
+        unsigned reads = countReads(kl, i, j-1);
+        kmer_class kc = make_pair(make_pair(i, j-1), reads);
+        if (reads && (heap.size() < N || better(kc, heap.top())))
+        {
+            if (heap.size() == N)
+                heap.pop();
+            heap.push(kc);
+        }
+        i = j;
+    }
+
+    kmer_class_vector result(heap.size());
+    for (kmer_class_vector::reverse_iterator it = result.rbegin(); it != result.rend(); ++it)
+    {
+        *it = heap.top();
+        heap.pop();
+    }
+    return result;
+}
+
+void CGkArray::mergeTopKmers(kmer_class_vector &a, kmer_class_vector const &b, unsigned N, kmer_order order)
+{
+    kmer_class_vector merged(a.size() + b.size());
+    std::merge(a.begin(), a.end(), b.begin(), b.end(), merged.begin(), KmerClassBetter(order));
+    if (merged.size() > N)
+        merged.resize(N);
+    a.swap(merged);
+}
+
+CGkArray::position_vector CGkArray::reportOccs(sa_range const &range) const
+{
+    position_vector result;
+    if (range.first > range.second)
+        return result;
+    vector<ulong> sapos;
+    sapos.reserve(range.second - range.first + 1);
+    for (ulong i = range.first; i <= range.second; ++i)
+        sapos.push_back(i);
+    locate(sapos, result);
+    return result;
+}
+
+/**
+ * Batched locate
+ *
+ * All unresolved suffixes take one LF step per round, so after d rounds
+ * each of them is at distance d from its starting point. The active
+ * suffixes are kept sorted by SA position: consecutive SA positions form 
+ * a segment, and a segment that is a single run of the same symbol 
+ * in BWT is LF-mapped as a block (cf. RLCSA::processRun). Other segments
+ * are mapped one suffix at a time, prefetching a few suffixes ahead.
+ */
+void CGkArray::locate(vector<ulong> const &sapos, position_vector &result) const
+{
+    const ulong runThreshold = 4;   // Minimum length of a segment to test for a run
+    const ulong prefetchDistance = 8;
+
+    result.resize(sapos.size());
+    // Active suffixes as pairs of <SA position, index in result>
+    vector<pair<ulong, ulong> > active, next;
+    active.reserve(sapos.size());
+    for (ulong k = 0; k < sapos.size(); ++k)
+        active.push_back(make_pair(sapos[k], k));
+    next.reserve(sapos.size());
+
+    for (ulong dist = 0; !active.empty(); ++dist)
+    {
+        next.clear();
+        ulong k = 0;
+        while (k < active.size())
+        {
+            // Find the segment of consecutive SA positions [k, e)
+            ulong e = k + 1;
+            while (e < active.size() && active[e].first == active[e-1].first + 1)
+                ++e;
+
+            // Resolve the sampled suffixes of the segment
+            ulong u = active[k].first;
+            ulong v = active[e-1].first;
+            ulong y = nextOne(sampled, u);
+            ulong r = y <= v ? sampled->rank1(y) : 0;
+            ulong r0 = r;
+            while (y <= v)
+            {
+                ulong j = k + (y - u);
+                result[active[j].second] = textPosToReadPos(suffixes->get(r-1) + dist);
+                QueryStats::locateWalk(dist);
+                active[j].first = ~0lu; // Mark resolved
+                y = nextOne(sampled, y+1);
+                ++r;
+            }
+
+            // Try to LF-map the whole segment at once, if none of it was resolved
+            ulong rank_u = 0;
+            uchar c = 0;
+            bool run = false;
+            if (r == r0 && e - k >= runThreshold)
+            {
+                c = alphabetrank->access(u, rank_u);
+                run = c != '\0' && alphabetrank->rank(c, v) - rank_u == v - u;
+            }
+            if (run)
+            {
+                ulong lf = C[c] + rank_u - 1;
+                QueryStats::lfSteps(e - k);
+                for (ulong j = k; j < e; ++j)
+                    next.push_back(make_pair(lf + (j - k), active[j].second));
+                k = e;
+                continue;
+            }
+
+            // One suffix at a time
+            for (ulong j = k; j < e; ++j)
+            {
+                if (j + prefetchDistance < e && active[j + prefetchDistance].first != ~0lu)
+                    alphabetrank->prefetch(active[j + prefetchDistance].first);
+                if (active[j].first == ~0lu)
+                    continue;
+                ulong tmp_rank_c = 0;
+                if (j == k && rank_u)
+                    tmp_rank_c = rank_u; // c was computed above
+                else
+                    c = alphabetrank->access(active[j].first, tmp_rank_c);
+                if (c == '\0')
+                {
+                    // Rank among the end-markers in BWT
+                    result[active[j].second] = make_pair(Doc->access(tmp_rank_c-1), dist);
+                    QueryStats::locateWalk(dist);
+                }
+                else
+                {
+                    next.push_back(make_pair(C[c]+tmp_rank_c-1, active[j].second));
+                    QueryStats::lfSteps(1);
+                }
+            }
+            k = e;
+        }
+        // Keep the active suffixes sorted to find the segments
+        std::sort(next.begin(), next.end());
+        active.swap(next);
+    }
+}
+
 /**
  * Constructor inits an empty dynamic FM-index.
  * Samplerate defaults to TEXTCOLLECTION_DEFAULT_SAMPLERATE.
  */
 CGkArray::CGkArray(uchar * bwt, ulong length, unsigned samplerate_, unsigned numberOfTexts_, 
-                   ulong maxTextLength_, unsigned gk_, bool verbose)
-    : n(length), samplerate(samplerate_), alphabetrank(0), sampled(0), Blast(0), Blcp(0), gk(gk_),
-      suffixes(0), positions(0), textStartPos(0), numberOfTexts(numberOfTexts_), maxTextLength(maxTextLength_), 
-      Doc(0)
+                   ulong maxTextLength_, unsigned gk_, bool verbose,
+                   static_bitsequence_builder *bsbSampled, static_bitsequence_builder *bsbBlast,
+                   static_bitsequence_builder *bsbBlcp, unsigned isaSamplerate_, bool isaReadAnchored,
+                   bool bothStrands_, uchar *bwtRev, vector<unsigned> const &extraGk, bool readRanges)
+    : n(length), samplerate(samplerate_), isaSamplerate(isaSamplerate_ ? isaSamplerate_ : samplerate_),
+      alphabetrank(0), sampled(0), gk(gk_), layers(),
+      suffixes(0), positions(0), isaSampled(0), readBoundary(0), numberOfTexts(numberOfTexts_), maxTextLength(maxTextLength_), 
+      bothStrands(bothStrands_), Doc(0), alphabetrankRev(0)
 {
-    if (gk < 3)
-    {
-        cerr << "CGkArray::CGkArray(): error: gk < 3" << endl;
-        abort();
-    }
+    // Default k-mer length first, duplicates are ignored
+    vector<unsigned> ks(1, gk);
+    for (vector<unsigned>::const_iterator it = extraGk.begin(); it != extraGk.end(); ++it)
+        if (std::find(ks.begin(), ks.end(), *it) == ks.end())
+            ks.push_back(*it);
+    for (vector<unsigned>::const_iterator it = ks.begin(); it != ks.end(); ++it)
+        if (*it < 3)
+        {
+            cerr << "CGkArray::CGkArray(): error: gk < 3" << endl;
+            abort();
+        }
 
     makewavelet(bwt); // Deletes bwt!
     bwt = 0;
 
-    Blcp = buildBlcp();
+    // Default bit vector is uncompressed plus rank directory
+    static_bitsequence_builder_brw32 defaultBuilder(16);
+    if (!bsbSampled) bsbSampled = &defaultBuilder;
+    if (!bsbBlast) bsbBlast = &defaultBuilder;
+    if (!bsbBlcp) bsbBlcp = &defaultBuilder;
+
+    for (vector<unsigned>::const_iterator it = ks.begin(); it != ks.end(); ++it)
+    {
+        KmerLayer kl;
+        kl.k = *it;
+        kl.Blcp = buildBlcp(alphabetrank, kl.k, bsbBlcp);
+        kl.Blast = 0;
+        kl.Dlast = 0;
+        kl.BlcpRev = 0;
+        layers.push_back(kl);
+    }
+    if (bwtRev)
+    {
+        // Reverse index for extendRight() and moveRight()
+        alphabetrankRev = HuffWT::makeHuffWT(bwtRev, n); // Deletes bwtRev!
+        bwtRev = 0;
+        for (vector<KmerLayer>::iterator it = layers.begin(); it != layers.end(); ++it)
+            it->BlcpRev = buildBlcp(alphabetrankRev, it->k, bsbBlcp);
+    }
 
-    // Make sampling tables and B_last (requires B_lcp)
-    assert(Blcp != 0);
-    maketables(verbose);
+    // Make sampling tables and B_last of each layer (requires B_lcp)
+    maketables(verbose, bsbSampled, bsbBlast, isaReadAnchored, readRanges);
 }
 
 /**
@@ -303,6 +996,11 @@ void CGkArray::save(std::string const & filename) const
         throw std::runtime_error("CGkArray::save(): file write error (n).");
     if (std::fwrite(&(this->samplerate), sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("CGkArray::save(): file write error (samplerate).");
+    if (std::fwrite(&(this->isaSamplerate), sizeof(unsigned), 1, file) != 1)
+        throw std::runtime_error("CGkArray::save(): file write error (isaSamplerate).");
+    uchar isaReadAnchored = isaSampled ? 1 : 0;
+    if (std::fwrite(&isaReadAnchored, 1, 1, file) != 1)
+        throw std::runtime_error("CGkArray::save(): file write error (isaReadAnchored).");
     if (std::fwrite(&(this->gk), sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("CGkArray::save(): file write error (gk).");
 
@@ -314,18 +1012,45 @@ void CGkArray::save(std::string const & filename) const
     
     HuffWT::save(alphabetrank, file);
     sampled->save(file);
-    Blast->save(file);
-    Blcp->save(file);
+    unsigned nlayers = layers.size();
+    if (std::fwrite(&nlayers, sizeof(unsigned), 1, file) != 1)
+        throw std::runtime_error("CGkArray::save(): file write error (number of layers).");
+    for (vector<KmerLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+    {
+        if (std::fwrite(&(it->k), sizeof(unsigned), 1, file) != 1)
+            throw std::runtime_error("CGkArray::save(): file write error (layer k).");
+        it->Blast->save(file);
+        it->Blcp->save(file);
+        uchar hasDlast = it->Dlast ? 1 : 0;
+        if (std::fwrite(&hasDlast, 1, 1, file) != 1)
+            throw std::runtime_error("CGkArray::save(): file write error (Dlast).");
+        if (it->Dlast && it->Dlast->save(file))
+            throw std::runtime_error("CGkArray::save(): file write error (Dlast).");
+    }
 
     suffixes->Save(file);
     positions->Save(file);
+    if (isaSampled)
+        isaSampled->save(file);
     
     if (std::fwrite(&(this->numberOfTexts), sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("CGkArray::save(): file write error (numberOfTexts).");
     if (std::fwrite(&(this->maxTextLength), sizeof(ulong), 1, file) != 1)
         throw std::runtime_error("CGkArray::save(): file write error (maxTextLength).");
+    uchar strands = bothStrands ? 1 : 0;
+    if (std::fwrite(&strands, 1, 1, file) != 1)
+        throw std::runtime_error("CGkArray::save(): file write error (bothStrands).");
+    uchar bidirectional = alphabetrankRev ? 1 : 0;
+    if (std::fwrite(&bidirectional, 1, 1, file) != 1)
+        throw std::runtime_error("CGkArray::save(): file write error (bidirectional).");
 
     Doc->save(file);
+    if (alphabetrankRev)
+    {
+        HuffWT::save(alphabetrankRev, file);
+        for (vector<KmerLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+            it->BlcpRev->save(file);
+    }
 
     fflush(file);
     std::fclose(file);
@@ -333,6 +1058,41 @@ void CGkArray::save(std::string const & filename) const
 
 
 
+/**
+ * Print the size and the average latency of rank1(), prev() and next()
+ * of the given bit vector. Used for the verbose size breakdown.
+ */
+static void reportBitsequence(char const *name, static_bitsequence *bs)
+{
+    const unsigned nprobes = 1u << 20;
+    uint len = bs->length();
+    uint first = bs->next(0); // prev() is undefined before the first 1-bit
+    if (first >= len)
+        return;
+    vector<uint> probes(nprobes);
+    std::mt19937_64 rng(len); // Leaves the global rand() state to the caller
+    for (unsigned i = 0; i < nprobes; ++i)
+        probes[i] = first + (uint)(rng() % (len - first));
+
+    double nsec[3];
+    volatile uint checksum = 0; // Keeps the compiler from dropping the calls
+    for (unsigned op = 0; op < 3; ++op)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < nprobes; ++i)
+            switch (op)
+            {
+            case 0: checksum += bs->rank1(probes[i]); break;
+            case 1: checksum += bs->prev(probes[i]); break;
+            default: checksum += bs->next(probes[i]); break;
+            }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        nsec[op] = std::chrono::duration<double, std::nano>(stop - start).count() / nprobes;
+    }
+    cerr << name << ": " << bs->size() << " bytes, " << 8.0 * bs->size() / len << " bits/bit, "
+         << bs->count_one() << " ones, " << nsec[0] << " / " << nsec[1] << " / " << nsec[2] << " ns" << endl;
+}
+
 const char ALPHABET_DNA[] = {'A', 'C', 'G', 'T', 'N'};
 pair<ulong, ulong> intervalList[256];
 
@@ -342,7 +1102,7 @@ pair<ulong, ulong> intervalList[256];
  * Computing the Longest Common Prefix Array Based on the Burrows-Wheeler Transform
  * SPIRE 2011, LNCS 7024, pp. 197–208, 2011.
  */
-void CGkArray::traverseBWT(uint *lcp)
+void CGkArray::traverseBWT(HuffWT *wt, uint *lcp, unsigned k)
 {
     deque<pair<pair<ulong, ulong>, uchar> > intervals;
     intervals.push_back(make_pair(make_pair(0,n-1), 0));
@@ -353,7 +1113,7 @@ void CGkArray::traverseBWT(uint *lcp)
         ulong e = intervals.front().first.second;
         uchar l = intervals.front().second;
         intervals.pop_front();
-        alphabetrank->getIntervals(s, e);
+        wt->getIntervals(s, e);
         for (const char *c = ALPHABET_DNA; c < ALPHABET_DNA + sizeof(ALPHABET_DNA); ++c)
         {
             ulong nmin = intervalList[(int)*c].first;
@@ -364,13 +1124,13 @@ void CGkArray::traverseBWT(uint *lcp)
             if (!bitget32(lcp, nmax+1)) 
             {
                 bitset32(lcp, nmax+1);
-                if ((unsigned)l+1 < gk)
+                if ((unsigned)l+1 < k)
                     intervals.push_back(make_pair(make_pair(nmin, nmax), l+1));
             }
         }
     }
 }
-void CGkArray::traverseBWT(uint *lcp, ulong s, ulong e, unsigned l)
+void CGkArray::traverseBWT(HuffWT *wt, uint *lcp, ulong s, ulong e, unsigned l, unsigned k)
 {
     deque<pair<pair<ulong, ulong>, uchar> > intervals;
     intervals.push_back(make_pair(make_pair(s,e), l));
@@ -381,7 +1141,7 @@ void CGkArray::traverseBWT(uint *lcp, ulong s, ulong e, unsigned l)
         ulong e = intervals.front().first.second;
         uchar l = intervals.front().second;
         intervals.pop_front();
-        alphabetrank->getIntervals(s,e);
+        wt->getIntervals(s,e);
         for (const char *c = ALPHABET_DNA; c < ALPHABET_DNA + sizeof(ALPHABET_DNA); ++c)
         {
             ulong nmin = intervalList[(int)*c].first;
@@ -391,36 +1151,36 @@ void CGkArray::traverseBWT(uint *lcp, ulong s, ulong e, unsigned l)
             intervalList[(int)*c] = make_pair(1,0);
             for (ulong i = nmin; i <= nmax+1; ++i)
                 bitset32(lcp, i);
-            if (l < gk)
+            if (l < k)
                 intervals.push_back(make_pair(make_pair(nmin, nmax), l+1));
         }
     }
 }
 
-static_bitsequence_brw32 * CGkArray::buildBlcp()
+static_bitsequence * CGkArray::buildBlcp(HuffWT *wt, unsigned k, static_bitsequence_builder *bsb)
 {
     uint *lcp = new uint[(n+1)/32+1];
     for (ulong i = 0; i < (n+1)/32+1; ++i)
         lcp[i] = 0;
     bitset32(lcp, 0);
     bitset32(lcp, n);
-    // Traverse all except suffixes with '\0' in their gk-length prefix
-    alphabetrank->setC(C);
-    alphabetrank->setList(intervalList);
+    // Traverse all except suffixes with '\0' in their k-length prefix
+    wt->setC(C);
+    wt->setList(intervalList);
     for (unsigned i = 0; i < 256; ++i)
         intervalList[i] = make_pair(1,0);
-    traverseBWT(lcp);
+    traverseBWT(wt, lcp, k);
 
-    // Traverse suffixes with '\0' in their gk-length prefix
+    // Traverse suffixes with '\0' in their k-length prefix
     ulong nmin = 0;
-    ulong nmax = LF(0, n-1)-1;
+    ulong nmax = C[0] + wt->rank(0, n-1) - 1;
     for (unsigned i = 0; i < 256; ++i)
         intervalList[i] = make_pair(1,0);
-    traverseBWT(lcp, nmin, nmax, 2);
+    traverseBWT(wt, lcp, nmin, nmax, 2, k);
     for (; nmin <= nmax; ++nmin)
         bitset32(lcp, nmin);
 
-    static_bitsequence_brw32 *b = new static_bitsequence_brw32(lcp, n+1, 16);
+    static_bitsequence *b = bsb->build(lcp, n+1);
     delete [] lcp; 
     return b;
 }
@@ -432,15 +1192,17 @@ static_bitsequence_brw32 * CGkArray::buildBlcp()
  * For more info, see CGkArray::save().
  */
 CGkArray::CGkArray(std::string const & filename)
-    : n(0), samplerate(0), alphabetrank(0), sampled(0), Blast(0), Blcp(0), gk(0), suffixes(0), positions(0),
-      textStartPos(0), numberOfTexts(0), maxTextLength(0), Doc(0) 
+    : n(0), samplerate(0), isaSamplerate(0), alphabetrank(0), sampled(0), gk(0), layers(),
+      suffixes(0), positions(0), isaSampled(0), readBoundary(0), numberOfTexts(0), maxTextLength(0), bothStrands(false), Doc(0), 
+      alphabetrankRev(0)
 {
-    // Load textStartPos
+    // Load text start positions
     {
         std::ifstream ifs(filename + ".cgka_map");
         if (!ifs.good())
         { std::cerr << "error: unable to read input file " << filename << ".cgka_map" << std::endl; std::abort(); }
-        textStartPos = new CSA::DeltaVector(ifs);
+        CSA::DeltaVector textStartPos(ifs);
+        readBoundary = new ReadBoundary(textStartPos);
     }
     
 
@@ -459,6 +1221,11 @@ CGkArray::CGkArray(std::string const & filename)
         throw std::runtime_error("CGkArray::CGkArray(): file read error (n).");
     if (std::fread(&samplerate, sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("CGkArray::CGkArray(): file read error (samplerate).");
+    if (std::fread(&isaSamplerate, sizeof(unsigned), 1, file) != 1)
+        throw std::runtime_error("CGkArray::CGkArray(): file read error (isaSamplerate).");
+    uchar isaReadAnchored = 0;
+    if (std::fread(&isaReadAnchored, 1, 1, file) != 1)
+        throw std::runtime_error("CGkArray::CGkArray(): file read error (isaReadAnchored).");
     if (std::fread(&(this->gk), sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("CGkArray::CGkArray(): file read error (gk).");
 
@@ -469,19 +1236,68 @@ CGkArray::CGkArray(std::string const & filename)
         throw std::runtime_error("CGkArray::CGkArray(): file read error (bwt end position).");
 
     alphabetrank = HuffWT::load(file);
-    sampled = (static_bitsequence_brw32 *)static_bitsequence::load(file);
-    Blast = (static_bitsequence_brw32 *)static_bitsequence::load(file);
-    Blcp = (static_bitsequence_brw32 *)static_bitsequence::load(file);
+    makePackedTables();
+    sampled = static_bitsequence::load(file);
+    if (!sampled)
+        throw std::runtime_error("CGkArray::CGkArray(): file read error (bit vectors).");
+    unsigned nlayers = 0;
+    if (std::fread(&nlayers, sizeof(unsigned), 1, file) != 1 || nlayers == 0)
+        throw std::runtime_error("CGkArray::CGkArray(): file read error (number of layers).");
+    for (unsigned i = 0; i < nlayers; ++i)
+    {
+        KmerLayer kl;
+        kl.Dlast = 0;
+        kl.BlcpRev = 0;
+        if (std::fread(&(kl.k), sizeof(unsigned), 1, file) != 1)
+            throw std::runtime_error("CGkArray::CGkArray(): file read error (layer k).");
+        kl.Blast = static_bitsequence::load(file);
+        kl.Blcp = static_bitsequence::load(file);
+        layers.push_back(kl);
+        if (!kl.Blast || !kl.Blcp)
+            throw std::runtime_error("CGkArray::CGkArray(): file read error (bit vectors).");
+        uchar hasDlast = 0;
+        if (std::fread(&hasDlast, 1, 1, file) != 1)
+            throw std::runtime_error("CGkArray::CGkArray(): file read error (Dlast).");
+        if (hasDlast)
+        {
+            layers.back().Dlast = static_sequence_wvtree_noptrs::load(file);
+            if (!layers.back().Dlast)
+                throw std::runtime_error("CGkArray::CGkArray(): file read error (Dlast).");
+        }
+    }
 
     suffixes = new BlockArray(file);
     positions = new BlockArray(file);
+    if (isaReadAnchored)
+    {
+        isaSampled = static_bitsequence::load(file);
+        if (!isaSampled)
+            throw std::runtime_error("CGkArray::CGkArray(): file read error (isaSampled).");
+    }
 
     if (std::fread(&(this->numberOfTexts), sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("CGkArray::CGkArray(): file read error (numberOfTexts).");
     if (std::fread(&(this->maxTextLength), sizeof(ulong), 1, file) != 1)
         throw std::runtime_error("CGkArray::CGkArray(): file read error (maxTextLength).");
+    uchar strands = 0;
+    if (std::fread(&strands, 1, 1, file) != 1)
+        throw std::runtime_error("CGkArray::CGkArray(): file read error (bothStrands).");
+    bothStrands = strands != 0;
+    uchar bidirectional = 0;
+    if (std::fread(&bidirectional, 1, 1, file) != 1)
+        throw std::runtime_error("CGkArray::CGkArray(): file read error (bidirectional).");
 
     Doc = new ArrayDoc(file);
+    if (bidirectional)
+    {
+        alphabetrankRev = HuffWT::load(file);
+        for (vector<KmerLayer>::iterator it = layers.begin(); it != layers.end(); ++it)
+        {
+            it->BlcpRev = static_bitsequence::load(file);
+            if (!it->BlcpRev)
+                throw std::runtime_error("CGkArray::CGkArray(): file read error (BlcpRev).");
+        }
+    }
 
     
 /**
@@ -490,15 +1306,15 @@ CGkArray::CGkArray(std::string const & filename)
     {
         position_result pr;
         getPosition(pr, j);
-        cerr << j << " SA " << pr.first << "," << pr.second << " Blcp " << (Blcp->access(j) ? "1" : "0");
-        cerr << " Blast " << (Blast->access(j) ? "1" : "0") << "  ";
+        cerr << j << " SA " << pr.first << "," << pr.second << " Blcp " << (layers[0].Blcp->access(j) ? "1" : "0");
+        cerr << " Blast " << (layers[0].Blast->access(j) ? "1" : "0") << "  ";
         cerr << (char *)getSuffix(j, getGkSize());
         cerr << endl;
     }
 */
     /*cerr << "Blast ";
     for (ulong j = 0; j < n; ++j)
-        cerr << (Blast->access(j) ? "1" : "0");
+        cerr << (layers[0].Blast->access(j) ? "1" : "0");
     cerr << endl;
     */
     std::fclose(file);
@@ -510,10 +1326,18 @@ CGkArray::~CGkArray() {
     delete sampled;
     delete suffixes;
     delete positions;
-    delete textStartPos; 
+    delete isaSampled;
+    delete readBoundary;
     delete Doc;
-    delete Blast;
-    delete Blcp;
+    for (vector<KmerLayer>::iterator it = layers.begin(); it != layers.end(); ++it)
+    {
+        delete it->Blast;
+        delete it->Dlast;
+        delete it->Blcp;
+        delete it->BlcpRev;
+    }
+    if (alphabetrankRev)
+        HuffWT::deleteHuffWT(alphabetrankRev);
 }
 
 void CGkArray::makewavelet(uchar *bwt)
@@ -534,9 +1358,22 @@ void CGkArray::makewavelet(uchar *bwt)
     alphabetrank = HuffWT::makeHuffWT(bwt, n);
     // bwt was already deleted.
     bwt = 0;
+    makePackedTables();
 }
 
-void CGkArray::maketables(bool verbose)
+void CGkArray::makePackedTables()
+{
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        uchar c = "ACGTN"[i]; // The sixth symbol is '\0'
+        packedC[i] = C[c];
+        packedCount[i] = C[c+1] - C[c];
+        packedHuffCode[i] = packedCount[i] ? alphabetrank->code(c) : 0;
+    }
+}
+
+void CGkArray::maketables(bool verbose, static_bitsequence_builder *bsbSampled, 
+                          static_bitsequence_builder *bsbBlast, bool isaReadAnchored, bool readRanges)
 {
     // Calculate BWT end-marker position (of last inserted text)
     {
@@ -553,11 +1390,21 @@ void CGkArray::maketables(bool verbose)
         this->bwtEndPos = i;
     }
 
-    // Init data structures to construct Blast
-    unsigned *Bl = new unsigned[n/32+1];
-    for (ulong i = 0; i < n/32+1; ++i)
-        Bl[i] = 0;
-    unordered_map<ulong, ulong> trie;
+    // Init data structures to construct Blast of each layer
+    const unsigned nlayers = layers.size();
+    vector<unsigned *> Bl(nlayers);
+    for (unsigned l = 0; l < nlayers; ++l)
+    {
+        Bl[l] = new unsigned[n/32+1];
+        for (ulong i = 0; i < n/32+1; ++i)
+            Bl[l][i] = 0;
+    }
+    vector<unordered_map<ulong, ulong> > trie(nlayers);
+    // Read number at the 1-bits of Bl, compacted into Dlast at the end
+    vector<BlockArray *> Blreads(nlayers, (BlockArray *)0);
+    if (readRanges)
+        for (unsigned l = 0; l < nlayers; ++l)
+            Blreads[l] = new BlockArray(n, Tools::CeilLog2(numberOfTexts));
 
 
     // Build up array for text starting positions
@@ -567,11 +1414,30 @@ void CGkArray::maketables(bool verbose)
     // Mapping from end-markers to doc ID's:
     BlockArray *endmarkerDocId = new BlockArray(numberOfTexts, Tools::CeilLog2(numberOfTexts));
 
+    // Inverse SA at every samplerate'th text position, used to build suffixes
     unsigned sampleLength = (n%samplerate==0) ? n/samplerate : n/samplerate+1;
-    positions = new BlockArray(sampleLength, Tools::CeilLog2(this->n));
+    BlockArray *saPositions = new BlockArray(sampleLength, Tools::CeilLog2(this->n));
     uint *sampledpositions = new uint[n/(sizeof(uint)*8)+1];
     for (ulong i = 0; i < n / (sizeof(uint)*8) + 1; i++)
         sampledpositions[i] = 0;
+
+    // Inverse SA samples: either every isaSamplerate'th text position,
+    // or every isaSamplerate'th position counting backwards from each read end
+    uint *isaSampledpositions = 0;
+    vector<ulong> isaAnchors; // Inverse SA values in decreasing text position order
+    ulong isaFirst = 0;      // Inverse SA value of text position 0
+    ulong readEnd = n-1;     // Text position of the end-marker of the current read
+    if (isaReadAnchored)
+    {
+        isaSampledpositions = new uint[n/(sizeof(uint)*8)+1];
+        for (ulong i = 0; i < n / (sizeof(uint)*8) + 1; i++)
+            isaSampledpositions[i] = 0;
+    }
+    else if (isaSamplerate == samplerate)
+        positions = saPositions;
+    else
+        positions = new BlockArray((n%isaSamplerate==0) ? n/isaSamplerate : n/isaSamplerate+1, 
+                                   Tools::CeilLog2(this->n));
     
     ulong x,p=bwtEndPos;
     // Keeping track of text position of prev. end-marker seen
@@ -592,23 +1458,40 @@ void CGkArray::maketables(bool verbose)
         if (x % samplerate == 0)
         {
             set_field(sampledpositions,1,p,1);
-            (*positions)[x/samplerate] = p;
+            (*saPositions)[x/samplerate] = p;
         }
-
-        if (posOfSuccEndmarker - i > gk)
+        if (isaReadAnchored)
         {
-            ulong r = Blcp->rank1(p);
-            ulong& value = trie[r]; // Returns reference to new value 0 if the key-value pair does not exists.
-            if (!value)
+            if (x == 0)
+                isaFirst = p; // End of the first read is not known yet
+            else if (x < readEnd && (readEnd - x) % isaSamplerate == 0)
+            {
+                bitset32(isaSampledpositions, x);
+                isaAnchors.push_back(p);
+            }
+        }
+        else if (positions != saPositions && x % isaSamplerate == 0)
+            (*positions)[x/isaSamplerate] = p;
+
+        for (unsigned l = 0; l < nlayers; ++l)
+            if (posOfSuccEndmarker - i > layers[l].k)
             {
-                value = p+1; // +1 since we assume 0 is equal to "not set"
-                bitset32(Bl, p);
-            } 
-        }                
+                ulong r = layers[l].Blcp->rank1(p);
+                ulong& value = trie[l][r]; // Returns reference to new value 0 if the key-value pair does not exists.
+                if (!value)
+                {
+                    value = p+1; // +1 since we assume 0 is equal to "not set"
+                    bitset32(Bl[l], p);
+                    if (readRanges)
+                        (*Blreads[l])[p] = textId; // Read of text position x
+                } 
+            }                
 
         if (c == '\0')
         {
-            trie.clear(); // Flush the trie
+            readEnd = i;
+            for (unsigned l = 0; l < nlayers; ++l)
+                trie[l].clear(); // Flush the trie
             --textId;
             
             // Record the order of end-markers in BWT:
@@ -629,13 +1512,24 @@ void CGkArray::maketables(bool verbose)
         else // Now c != '\0', do LF-mapping:
             p = C[c]+alphabetrank_i_tmp-1;
     }
-    trie.clear();
+    // Text position 0 was visited first, before the tries of the first read
+    // were filled: now readEnd is the end of the first read
+    for (unsigned l = 0; l < nlayers; ++l)
+    {
+        if (readEnd >= layers[l].k && !trie[l][layers[l].Blcp->rank1(bwtEndPos)])
+        {
+            bitset32(Bl[l], bwtEndPos);
+            if (readRanges)
+                (*Blreads[l])[bwtEndPos] = 0;
+        }
+        trie[l].clear();
+    }
     assert(textId == 0);
     
     if (verbose)
         cerr << "Sampling first phase done. Wall-clock time: " << std::difftime(time(NULL), wctime) << " s." << endl; 
 
-    sampled = new static_bitsequence_brw32(sampledpositions, n, 16);
+    sampled = bsbSampled->build(sampledpositions, n);
     delete [] sampledpositions;
     assert(sampled->rank1(n-1) == sampleLength);
 
@@ -656,25 +1550,75 @@ void CGkArray::maketables(bool verbose)
             cerr << "Building suffixes " << 100.0*(i)/sampleLength 
                  << ", Wall-clock time: " << std::difftime(time(NULL), wctime) << " s." << endl; 
 
-        ulong j = sampled->rank1((*positions)[i]);
+        ulong j = sampled->rank1(saPositions->get(i));
         if (j==0) j=sampleLength;
         (*suffixes)[j-1] = (i*samplerate==n)?0:i*samplerate;
     }
+    if (positions != saPositions)
+        delete saPositions;
+    saPositions = 0;
+
+    if (isaReadAnchored)
+    {
+        // Now readEnd is the end of the first read
+        bool firstSampled = readEnd > 0 && readEnd % isaSamplerate == 0;
+        if (firstSampled)
+            bitset32(isaSampledpositions, 0);
+        positions = new BlockArray(isaAnchors.size() + (firstSampled ? 1 : 0), Tools::CeilLog2(this->n));
+        ulong k = 0;
+        if (firstSampled)
+            (*positions)[k++] = isaFirst;
+        for (vector<ulong>::reverse_iterator it = isaAnchors.rbegin(); it != isaAnchors.rend(); ++it)
+            (*positions)[k++] = *it;
+        isaSampled = bsbSampled->build(isaSampledpositions, n);
+        delete [] isaSampledpositions;
+    }
 
     if (verbose)
         cerr << "Sampling second phase done. Wall-clock time: " << std::difftime(time(NULL), wctime) << " s." << endl; 
 
-    Blast = new static_bitsequence_brw32(Bl, n, 16);
-    delete [] Bl;
+    for (unsigned l = 0; l < nlayers; ++l)
+    {
+        layers[l].Blast = bsbBlast->build(Bl[l], n);
+        ulong ones = layers[l].Blast->count_one();
+        if (readRanges && ones)
+        {
+            uint *reads = new uint[ones];
+            ulong m = 0;
+            for (ulong i = 0; i < n; ++i)
+                if (bitget32(Bl[l], i))
+                    reads[m++] = Blreads[l]->get(i);
+            static_bitsequence_builder_brw32 bsb(16);
+            // Wavelet tree takes the ownership of reads
+            layers[l].Dlast = new static_sequence_wvtree_noptrs(reads, ones, &bsb, new alphabet_mapper_none(), true);
+        }
+        delete Blreads[l];
+        delete [] Bl[l];
+    }
     
     if (verbose)
+    {
         cerr << "breakdown of size: " << endl
              << "WT: n/a" << endl
              << "suffixes: " << suffixes->size() << endl
              << "positions: " << positions->size() << endl
-             << "sampled: " << sampled->size() << endl
-             << "B_last: " << Blast->size() << endl
-             << "B_lcp: " << Blcp->size() << endl
-             << "Doc: " << Doc->size() << endl
+             << "isaSampled: " << (isaSampled ? isaSampled->size() : 0) << endl
+             << "sampled: " << sampled->size() << endl;
+        for (vector<KmerLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+            cerr << "B_last (k=" << it->k << "): " << it->Blast->size() << endl
+                 << "Dlast (k=" << it->k << "): " << (it->Dlast ? it->Dlast->size() : 0) << endl
+                 << "B_lcp (k=" << it->k << "): " << it->Blcp->size() << endl
+                 << "reverse B_lcp (k=" << it->k << "): " << (it->BlcpRev ? it->BlcpRev->size() : 0) << endl;
+        cerr << "Doc: " << Doc->size() << endl
+             << "reverse WT: " << (alphabetrankRev ? "n/a" : "none") << endl
              << "textStartPos: see file *.cgka_map" << endl;
+        cerr << "bit vector tradeoff (size, bits per bit, rank1/prev/next ns per call):" << endl;
+        reportBitsequence("sampled", sampled);
+        for (vector<KmerLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+        {
+            std::string k = std::to_string(it->k);
+            reportBitsequence(("B_last (k=" + k + ")").c_str(), it->Blast);
+            reportBitsequence(("B_lcp (k=" + k + ")").c_str(), it->Blcp);
+        }
+    }
 }
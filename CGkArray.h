@@ -20,8 +20,9 @@
 #define _CGkArray_H_
 
 #include "BlockArray.h"
-#include "ArrayDoc.h"
 #include "HuffWT.h"
+#include "ReadBoundary.h"
+#include "QueryStats.h"
 
 // Include from RLCSA
 #include "bits/deltavector.h"
@@ -29,6 +30,8 @@
 // Include from libcds
 #include <basics.h> // Defines W == 32
 #include <static_bitsequence.h>
+#include <static_bitsequence_builder.h>
+#include "ArrayDoc.h"
 
 // Libcds includes will collide with #define W.
 // Re-defining the word size to ulong:
@@ -40,12 +43,21 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <stdexcept>
 
 /**
  * Implementation of the Compressed Gk Arrays
  *
  * Use TextCollectionBuilder to construct.
  *
+ * The index can hold B_lcp and B_last for several k-mer lengths that share 
+ * the BWT, the samples and the document array. All k-mer dependent methods 
+ * take the k-mer length as an optional last parameter; 0 (the default) 
+ * means the default k-mer length, see getGkSize() and getGkSizes().
+ *
+ * Thread safety: the queries (all const methods) only read the index, 
+ * so one index can be shared by any number of threads, as the tools 
+ * do in their OpenMP loops. Query statistics are kept per thread.
  */
 class CGkArray
 {
@@ -61,6 +73,57 @@ public:
     typedef std::pair<ulong,ulong> sa_range;
     // Internal pointer for move left (on arbitrary patterns)
     typedef std::pair<sa_range,unsigned> internal_pointer;
+    // Pair of forward and reverse suffix array ranges (bidirectional index)
+    typedef std::pair<sa_range,sa_range> bidirectional_range;
+    // Internal pointer for move right (on arbitrary patterns)
+    typedef std::pair<bidirectional_range,unsigned> bidirectional_pointer;
+    // Suffix array range of an approximate match and the mismatching k-mer positions
+    typedef std::pair<sa_range,std::vector<unsigned> > approximate_match;
+    // Vector of approximate matches
+    typedef std::vector<approximate_match> approximate_vector;
+    // Distinct k-mer: its suffix array range (see countOccs()) and countReads()
+    typedef std::pair<sa_range,unsigned> kmer_class;
+    // Vector of distinct k-mers
+    typedef std::vector<kmer_class> kmer_class_vector;
+    // Ranking criterion of topKmers()
+    enum kmer_order { by_occs, by_reads };
+    // k-mer of at most 32 bases packed two bits per base, A=0, C=1, G=2, T=3,
+    // the first base in the highest bits. N is given by a separate mask of
+    // the same layout, where both bits of an N base are set (its code is 0).
+    typedef ulong packed_kmer;
+    static const unsigned MAX_PACKED_K = 32;
+
+    /**
+     * Sequence packed two bits per base, e.g. a read or a pattern
+     *
+     * Base i is stored in bases[i/32], the first base of each word in the 
+     * highest bits, with the encoding of packed_kmer. Bit i%64 of nmask[i/64]
+     * is set if base i is N; nmask is empty if the sequence has no N's.
+     */
+    struct packed_sequence
+    {
+        std::vector<ulong> bases;
+        std::vector<ulong> nmask;
+        ulong length;
+
+        packed_sequence()
+            : bases(), nmask(), length(0)
+        { }
+        // Packs a '\0'-terminated string, symbols other than ACGT become N
+        explicit packed_sequence(uchar const *);
+
+        // Base i as ASCII, and '\0' for i == length
+        inline uchar operator[](ulong i) const
+        {
+            if (i >= length)
+                return '\0';
+            if (!nmask.empty() && (nmask[i/64] >> (i%64) & 1))
+                return 'N';
+            return "ACGT"[(bases[i/32] >> (62 - 2*(i%32))) & 3];
+        }
+    };
+    // Operation counts of the queries, see getQueryStats()
+    typedef QueryStatsCounts query_stats;
 
     /**
      * Convert from text position to a pair of <read number, read position>
@@ -72,11 +135,21 @@ public:
      */
     inline position_result textPosToReadPos(ulong i) const
     {
-        CSA::DeltaVector::Iterator iter(*textStartPos);
-        unsigned read = iter.rank(i)-1;
-        return std::make_pair(read, i - iter.select(read));
+        unsigned read = readBoundary->read(i);
+        return std::make_pair(read, i - readBoundary->start(read));
     }
 
+    /**
+     * Batch conversion from text positions to pairs of <read number, read position>
+     *
+     * Consecutive positions inside the same read are resolved without
+     * a new look-up, so sorted input is the fastest.
+     *
+     * Input: Vector of text positions
+     * Output: Vector of read numbers + read positions (in the same order)
+     */
+    position_vector textPosToReadPos(std::vector<ulong> const &) const;
+
     /**
      * Convert from a pair of <read number, read position> to text position
      * 
@@ -87,20 +160,26 @@ public:
      */
     inline ulong readPosToTextPos(unsigned read, ulong i) const
     {
-        CSA::DeltaVector::Iterator iter(*textStartPos);
-        return iter.select(read) + i;
+        return readBoundary->start(read) + i;
     }
 
+    /**
+     * Batch conversion from pairs of <read number, read position> to text positions
+     *
+     * Input: Vector of read numbers + read positions
+     * Output: Vector of text positions (in the same order)
+     */
+    std::vector<ulong> readPosToTextPos(position_vector const &) const;
+
     /**
      * Check if given text position is valid (i.e. k-mer does not span over a '\0' byte).
      *
      * Input: Text position, use readPosToTextPos() to convert
      */
-    inline bool isValidTextPos(ulong i) const
+    inline bool isValidTextPos(ulong i, unsigned k = 0) const
     {
-        CSA::DeltaVector::Iterator iter(*textStartPos);
-        unsigned read = iter.rank(i);
-        return (iter.select(read) - i > gk ? true : false);
+        unsigned read = readBoundary->read(i);
+        return (readBoundary->start(read+1) - i > layer(k).k ? true : false);
     }
 
     // Return total length of text (including 0-terminators).
@@ -109,15 +188,43 @@ public:
     // Return the length of the given read (including 0-terminator)
     ulong getLength(unsigned i) const
     {
-        CSA::DeltaVector::Iterator iter(*textStartPos);
-        return iter.select(i+1) - iter.select(i);
+        return readBoundary->length(i);
     }
-    // Return the k-mer size used in indexing
+    // Return the default k-mer size used in indexing
     unsigned getGkSize() const
     { return gk; }
+    // Return the operation counts (LF steps, rank calls, locate walks etc.) of 
+    // the queries run by the calling thread since the last resetQueryStats().
+    // Counts are always zero unless compiled with -DQUERY_STATS.
+    static query_stats getQueryStats()
+    { return QueryStats::get(); }
+    static void resetQueryStats()
+    { QueryStats::reset(); }
+    static bool queryStatsEnabled()
+    { return QueryStats::enabled; }
+    // Return all indexed k-mer sizes, the default k-mer size first
+    std::vector<unsigned> getGkSizes() const
+    {
+        std::vector<unsigned> ks;
+        for (std::vector<KmerLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+            ks.push_back(it->k);
+        return ks;
+    }
     // Return the number of indexed reads
     unsigned getNumberOfReads() const
     { return numberOfTexts; }
+    // Return true if the index contains both strands of each read.
+    // Then reads [0, getNumberOfReads()/2) are the input reads, and 
+    // read r + getNumberOfReads()/2 is the reverse complement of read r.
+    bool hasBothStrands() const
+    { return bothStrands; }
+    // Return true if the index supports extendRight() and moveRight()
+    bool isBidirectional() const
+    { return alphabetrankRev != 0; }
+    // Return true if the read numbers of B_last are stored, see the
+    // queries restricted to a range of reads
+    bool hasReadRanges() const
+    { return layers[0].Dlast != 0; }
 
     /**
      * Find the suffix array range for the given k-mer
@@ -125,7 +232,65 @@ public:
      * Input: k-mer
      * Output: Suffix array range
      */
-    sa_range kmerToSARange(uchar const *) const;
+    sa_range kmerToSARange(uchar const *, unsigned = 0) const;
+
+    /**
+     * Find the suffix array range for a packed k-mer
+     *
+     * The packed methods throw std::runtime_error if k (or the k-mer length
+     * of the index layer) is larger than MAX_PACKED_K.
+     *
+     * Input: k-mer and its N mask (0 if no N's), see packed_kmer
+     * Output: Suffix array range
+     */
+    sa_range packedKmerToSARange(packed_kmer, packed_kmer = 0, unsigned = 0) const;
+    // Batch version: result[i] is the range of kmers[i]. The searches of
+    // several k-mers are interleaved to overlap their memory accesses.
+    void packedKmerToSARange(std::vector<packed_kmer> const &, std::vector<sa_range> &, unsigned = 0) const;
+    // Batch version with N masks: nmasks[i] is the mask of kmers[i]
+    void packedKmerToSARange(std::vector<packed_kmer> const &, std::vector<packed_kmer> const &, 
+                             std::vector<sa_range> &, unsigned = 0) const;
+
+    // Packs the first k symbols of an ASCII k-mer, symbols other than ACGT become N.
+    // Returns the N mask. Throws if k > MAX_PACKED_K.
+    static packed_kmer packKmer(uchar const *, unsigned, packed_kmer &);
+    // Unpacks a k-mer into k symbols, the buffer must hold k+1 symbols.
+    // Throws if k > MAX_PACKED_K.
+    static void unpackKmer(packed_kmer, packed_kmer, unsigned, uchar *);
+
+    /**
+     * Extend the pattern P to cP (backward search step)
+     *
+     * Use the range (0, getLength()-1) for the empty pattern.
+     * Input: Suffix array range of P and symbol c
+     * Output: Suffix array range of cP, empty if cP was not found
+     */
+    sa_range extendLeft(sa_range const &range, uchar c) const
+    {
+        if (range.first > range.second)
+            return std::make_pair(1,0);
+        ulong sp = LF(c, range.first-1);
+        ulong ep = LF(c, range.second)-1;
+        if (sp > ep)
+            return std::make_pair(1,0);
+        return std::make_pair(sp, ep);
+    }
+
+    /**
+     * Find the suffix array ranges of all k-mers within the given Hamming distance
+     *
+     * Backward search backtracks over the symbols A, C, G and T at each
+     * position while mismatches remain, and empty ranges are pruned immediately.
+     *
+     * Input: k-mer, maximum number of mismatches (e.g. 1 or 2) and k-mer length
+     * Output: Suffix array range and mismatch positions (in increasing order) 
+     *         of each matching k-mer, in suffix array order. 
+     *         The exact match, if found, has no mismatch positions.
+     */
+    approximate_vector kmerToSARanges(uchar const *, unsigned, unsigned = 0) const;
+    // Batch version: result[i] holds the matches of the i'th k-mer
+    void kmerToSARanges(std::vector<uchar const *> const &, unsigned, 
+                        std::vector<approximate_vector> &, unsigned = 0) const;
 
     /**
      * Find the suffix array range for the k-mer at the given position
@@ -133,10 +298,11 @@ public:
      * Input: text position, use readPosToTextPos() to convert
      * Output: Suffix array range
      */
-    sa_range textPosToSARange(ulong x) const
+    sa_range textPosToSARange(ulong x, unsigned k = 0) const
     {
         ulong y = inverseSA(x);
-        return make_pair(Blcp->prev(y), Blcp->next(y+1)-1);
+        static_bitsequence *Blcp = layer(k).Blcp;
+        return make_pair(prevOne(Blcp, y), nextOne(Blcp, y+1)-1);
     }
     
     /**
@@ -150,7 +316,7 @@ public:
      * Output: Suffix array range of the preceeding read position. 
      *         After the last step, subsequent calls return an empty SA range.
      */
-    sa_range moveLeft(ulong &) const;
+    sa_range moveLeft(ulong &, unsigned = 0) const;
     /**
      * Move left operation for arbitrary patterns
      *
@@ -162,7 +328,9 @@ public:
      *         Range can be empty if the k-mer is not found in the index.
      *         After the last step, subsequent calls return an empty SA range.
      */
-    sa_range moveLeft(internal_pointer &, uchar const *) const;
+    sa_range moveLeft(internal_pointer &, uchar const *, unsigned = 0) const;
+    // Move left for packed sequences
+    sa_range moveLeft(internal_pointer &, packed_sequence const &, unsigned = 0) const;
 
     /**
      * Initialize move left
@@ -173,7 +341,7 @@ public:
      * Input: Read number
      * Output: <internal value> that points to the last k-mer of the given read.
      */
-    ulong initMoveLeft(unsigned) const;
+    ulong initMoveLeft(unsigned, unsigned = 0) const;
     /**
      * Initialize move left for arbitrary pattern
      *
@@ -183,7 +351,68 @@ public:
      * Input: Arbitrary string, assuming '\0'-terminated
      * Output: <internal pointer> that points to the last k-mer of the given pattern.
      */
-    internal_pointer initMoveLeft(uchar const *) const;
+    internal_pointer initMoveLeft(uchar const *, unsigned = 0) const;
+    // Initialize move left for packed sequences
+    internal_pointer initMoveLeft(packed_sequence const &, unsigned = 0) const;
+
+    /**
+     * Bidirectional index
+     *
+     * Requires an index that was built with the reverse BWT (see isBidirectional()),
+     * otherwise extendRight() and moveRight() throw a std::runtime_error.
+     * A bidirectional range holds the suffix array range of pattern P in the 
+     * forward index, and the range of the reversed pattern in the reverse index.
+     * The forward range can be passed to all queries Q1-Q4.
+     */
+
+    /**
+     * Find the bidirectional range for a pattern of given length
+     *
+     * Input: Pattern and its length (which can differ from k)
+     * Output: Bidirectional range, the forward range is empty if the pattern was not found
+     */
+    bidirectional_range patternToBidirectionalRange(uchar const *, unsigned) const;
+
+    /**
+     * Extend the pattern P to cP
+     *
+     * Input: Bidirectional range of P and symbol c
+     * Output: Bidirectional range of cP, the forward range is empty if cP was not found
+     */
+    bidirectional_range extendLeft(bidirectional_range const &, uchar) const;
+
+    /**
+     * Extend the pattern P to Pc
+     *
+     * Input: Bidirectional range of P and symbol c
+     * Output: Bidirectional range of Pc, the forward range is empty if Pc was not found
+     */
+    bidirectional_range extendRight(bidirectional_range const &, uchar) const;
+
+    /**
+     * Move right operation for arbitrary patterns
+     *
+     * Counterpart of moveLeft(): each call returns the SA range of the next 
+     * k-mer of the pattern, that is, the k-mers are traversed in forward order.
+     *
+     * Input: <bidirectional pointer>, use initMoveRight() to initialize, and
+     *        String that was used to initialize the pointer.
+     * Output: Suffix array range of the next position, starting from position 0. 
+     *         Range can be empty if the k-mer is not found in the index.
+     *         After the last k-mer, subsequent calls return an empty SA range.
+     */
+    sa_range moveRight(bidirectional_pointer &, uchar const *, unsigned = 0) const;
+
+    /**
+     * Initialize move right for arbitrary pattern
+     *
+     * Input: Arbitrary string, assuming '\0'-terminated
+     * Output: <bidirectional pointer> that points before the first k-mer of the pattern.
+     */
+    bidirectional_pointer initMoveRight(uchar const *) const
+    {
+        return std::make_pair(std::make_pair(std::make_pair(1,0), std::make_pair(1,0)), 0u);
+    }
 
     /**
      * Q1 In which reads does k-mer occur?
@@ -191,10 +420,11 @@ public:
      * Input: text position, use readPosToTextPos() to convert
      * Output: Vector of read numbers and positions (i.e. position of the last occurrence of f in each read)
      */
-    inline position_vector reportReads(ulong x) const
+    inline position_vector reportReads(ulong x, unsigned k = 0) const
     {
         ulong y = inverseSA(x);
-        return reportReads(Blcp->prev(y), Blcp->next(y+1)-1);
+        KmerLayer const &kl = layer(k);
+        return reportReads(kl, prevOne(kl.Blcp, y), nextOne(kl.Blcp, y+1)-1);
     }
 
     /**
@@ -203,9 +433,9 @@ public:
      * Input: range in the suffix array, use kmerToSARange() to find
      * Output: Vector of read numbers and positions (i.e. position of the last occurrence of f in each read)
      */
-    inline position_vector reportReads(sa_range const &range) const
+    inline position_vector reportReads(sa_range const &range, unsigned k = 0) const
     {
-        return reportReads(range.first, range.second);
+        return reportReads(layer(k), range.first, range.second);
     }
 
     /** 
@@ -213,10 +443,11 @@ public:
      *
      * Input: text position, use readPosToTextPos() to convert
      */
-    inline unsigned countReads(ulong x) const
+    inline unsigned countReads(ulong x, unsigned k = 0) const
     {
         ulong y = inverseSA(x);
-        return countReads(Blcp->prev(y), Blcp->next(y+1)-1);
+        KmerLayer const &kl = layer(k);
+        return countReads(kl, prevOne(kl.Blcp, y), nextOne(kl.Blcp, y+1)-1);
     }
 
     /** 
@@ -224,9 +455,9 @@ public:
      *
      * Input: range in the suffix array, use kmerToSARange() to find
      */
-    inline unsigned countReads(sa_range const &range) const
+    inline unsigned countReads(sa_range const &range, unsigned k = 0) const
     {
-        return countReads(range.first, range.second);
+        return countReads(layer(k), range.first, range.second);
     }
 
     /**
@@ -235,10 +466,9 @@ public:
      * Input: text position, use readPosToTextPos() to convert
      * Output: Vector of read numbers and positions (i.e. all occurrences of f)
      */
-    inline position_vector reportOccs(ulong x) const
+    inline position_vector reportOccs(ulong x, unsigned k = 0) const
     {
-        ulong y = inverseSA(x);
-        return reportOccs(make_pair(Blcp->prev(y), Blcp->next(y+1)-1));
+        return reportOccs(textPosToSARange(x, k));
     }
 
     /**
@@ -254,10 +484,11 @@ public:
      *
      * Input: text position, use readPosToTextPos() to convert
      */
-    inline unsigned countOccs(ulong x) const
+    inline unsigned countOccs(ulong x, unsigned k = 0) const
     {
         ulong y = inverseSA(x);
-        return (Blcp->next(y+1)-1) - Blcp->prev(y) + 1;
+        static_bitsequence *Blcp = layer(k).Blcp;
+        return (nextOne(Blcp, y+1)-1) - prevOne(Blcp, y) + 1;
     }
 
     /**
@@ -270,6 +501,143 @@ public:
         return range.second - range.first + 1;
     }
 
+    /**
+     * Enumerate the distinct k-mers
+     *
+     * Walks the runs of B_lcp that start inside the given suffix array 
+     * range. Runs of suffixes that contain an end-marker within their 
+     * first k symbols are skipped. The suffix array can be split into 
+     * chunks that are enumerated in parallel, see cgkspectrum.cpp. 
+     * Use getSuffix(range.first, k) to decode a k-mer.
+     *
+     * Input: first and last suffix array position, and the k-mer length
+     * Output: Appends the k-mers in suffix array order
+     */
+    void enumerateKmers(ulong, ulong, kmer_class_vector &, unsigned = 0) const;
+
+    /**
+     * Find the N most frequent k-mers
+     *
+     * One sequential pass over the runs of B_lcp (see enumerateKmers()) 
+     * with a bounded heap of size N; the k-mers are not decoded. Ties are 
+     * broken by suffix array order. The range can be given to scan the 
+     * suffix array in chunks, and mergeTopKmers() combines the results.
+     *
+     * Input: N, criterion (number of occurrences or reads), k-mer length, 
+     *        and first and last suffix array position (defaults to all)
+     * Output: At most N k-mers in decreasing order of frequency
+     */
+    kmer_class_vector topKmers(unsigned, kmer_order, unsigned = 0, ulong = 0, ulong = ~0lu) const;
+    // Merge the top N k-mers of b into a, both given by topKmers()
+    static void mergeTopKmers(kmer_class_vector &, kmer_class_vector const &, unsigned, kmer_order);
+
+    /**
+     * Q1 restricted to the reads [minRead, maxRead]
+     *
+     * Useful e.g. when reads of several libraries are pooled into one index.
+     * If the index has the read numbers of B_last (see hasReadRanges()), only
+     * the reads in [minRead, maxRead] are located, unless they are most of
+     * the reads of the range. Otherwise all reads are located and filtered.
+     *
+     * Input: range in the suffix array, use kmerToSARange() to find,
+     *        first and last read number (inclusive)
+     * Output: Vector of read numbers and positions (i.e. position of the last occurrence of f in each read)
+     */
+    position_vector reportReads(sa_range const &, unsigned, unsigned, unsigned = 0) const;
+
+    /**
+     * Q2 restricted to the reads [minRead, maxRead]
+     *
+     * Counted in logarithmic time if the index has the read numbers of
+     * B_last (see hasReadRanges()), otherwise as reportReads().size().
+     *
+     * Input: range in the suffix array, use kmerToSARange() to find,
+     *        first and last read number (inclusive)
+     */
+    unsigned countReads(sa_range const &, unsigned, unsigned, unsigned = 0) const;
+
+    /**
+     * In how many reads [minRead, maxRead] does k-mer occur as a prefix?
+     *
+     * Counted from the document array in logarithmic time.
+     *
+     * Input: range in the suffix array, use kmerToSARange() to find,
+     *        first and last read number (inclusive)
+     */
+    unsigned countReadPrefixes(sa_range const &range, unsigned minRead, unsigned maxRead) const
+    {
+        if (range.first > range.second)
+            return 0;
+        // Rows preceded by '\0' are the read starts
+        ulong i = range.first ? alphabetrank->rank('\0', range.first-1) : 0;
+        ulong j = alphabetrank->rank('\0', range.second);
+        if (i == j)
+            return 0;
+        return Doc->count(i, j-1, minRead, maxRead);
+    }
+
+    /**
+     * Which reads [minRead, maxRead] have k-mer as a prefix?
+     *
+     * Input: range in the suffix array, use kmerToSARange() to find,
+     *        first and last read number (inclusive)
+     * Output: Read numbers in increasing order
+     */
+    std::vector<int> reportReadPrefixes(sa_range const &range, unsigned minRead, unsigned maxRead) const
+    {
+        if (range.first > range.second)
+            return std::vector<int>();
+        ulong i = range.first ? alphabetrank->rank('\0', range.first-1) : 0;
+        ulong j = alphabetrank->rank('\0', range.second);
+        if (i == j)
+            return std::vector<int>();
+        return Doc->access(i, j-1, minRead, maxRead);
+    }
+
+    /**
+     * Canonical Q2: In how many reads does k-mer or its reverse complement occur?
+     *
+     * Counts each strand separately, i.e. the result is 
+     * countReads(kmer) + countReads(reverse complement of kmer).
+     * For an index with both strands this is a single countReads().
+     *
+     * Input: k-mer
+     */
+    unsigned countReadsCanonical(uchar const *, unsigned = 0) const;
+
+    /**
+     * Canonical Q1: In which reads does k-mer or its reverse complement occur?
+     *
+     * Input: k-mer
+     * Output: Vector of read numbers and positions, one for each read and strand.
+     *         The read numbers refer to the input reads, and the positions 
+     *         to their forward strand, i.e. the read contains either the k-mer 
+     *         or its reverse complement at the reported position.
+     */
+    position_vector reportReadsCanonical(uchar const *, unsigned = 0) const;
+
+    /**
+     * Read-coverage profile
+     *
+     * Computes countReads() for each k-mer of the given read, moving left
+     * over the read (see moveLeft()).
+     *
+     * Input: Read number
+     * Output: Coverage at each read position (empty if the read is shorter than k)
+     */
+    void coverage(unsigned, std::vector<unsigned> &, unsigned = 0) const;
+
+    /**
+     * Canonical read-coverage profile
+     *
+     * Computes countReadsCanonical() for each k-mer of the given read.
+     * For an index with both strands, the read is traversed only once.
+     *
+     * Input: Read number
+     * Output: Coverage at each read position (empty if the read is shorter than k)
+     */
+    void coverageCanonical(unsigned, std::vector<unsigned> &, unsigned = 0) const;
+
     /**
      * Returns a copy of an indexed read.
      *
@@ -292,16 +660,38 @@ public:
      */
     ulong inverseSA(ulong i) const
     {
-        ulong skip = samplerate - i % samplerate;
+        ulong skip;
         ulong j;
-        if (i / samplerate + 1 >= n / samplerate)
+        if (isaSampled)
+        {
+            // Read-end anchored samples: the walk never crosses a '\0',
+            // and the end-marker of read r is found at SA position r.
+            unsigned read = readBoundary->read(i);
+            ulong end = readBoundary->start(read+1) - 1;
+            ulong y = nextOne(isaSampled, i);
+            if (y > end)
+            {
+                j = read;
+                skip = end - i;
+            }
+            else
+            {
+                j = positions->get(isaSampled->rank1(y)-1);
+                skip = y - i;
+            }
+        }
+        else if (i / isaSamplerate + 1 >= n / isaSamplerate)
         {
             j = bwtEndPos;
             skip = n - i;
         }
         else
-            j = (*positions)[i/samplerate+1];                                                                              
+        {
+            j = positions->get(i/isaSamplerate+1);
+            skip = isaSamplerate - i % isaSamplerate;
+        }
         
+        QueryStats::lfSteps(skip);
         ulong tmp_rank_c = 0; // Cache rank value of c.
         while (skip > 0)
         {
@@ -335,48 +725,221 @@ public:
             c = alphabetrank->access(i, tmp_rank_c);
             ++ dist;
         }
+        QueryStats::lfSteps(dist);
+        QueryStats::locateWalk(dist);
         if (c == '\0')
         {
             // Look-up from the rank among the end-markers in BWT
             return std::make_pair(Doc->access(tmp_rank_c-1), dist); 
         }
 
-        return textPosToReadPos((*suffixes)[sampled->rank1(i)-1] + dist);
+        return textPosToReadPos(suffixes->get(sampled->rank1(i)-1) + dist);
     }
 
-    CGkArray(uchar *, ulong, unsigned, unsigned, ulong, unsigned, bool);
+    /**
+     * Bit vector builders for sampled, B_last and B_lcp can be given 
+     * as parameters 8-10. Null pointer defaults to 
+     * static_bitsequence_brw32 with factor 16. The builders are not deleted.
+     *
+     * The last two parameters give the sample rate of the inverse suffix
+     * array (0 defaults to the SA sample rate) and whether the inverse 
+     * samples are anchored to the read ends instead of the text positions.
+     *
+     * If the last parameter is set, the read numbers of B_last are stored
+     * for the queries restricted to a range of reads (see hasReadRanges()).
+     */
+    CGkArray(uchar *, ulong, unsigned, unsigned, ulong, unsigned, bool,
+             static_bitsequence_builder * = 0, static_bitsequence_builder * = 0, 
+             static_bitsequence_builder * = 0, unsigned = 0, bool = false, bool = false,
+             uchar * = 0, std::vector<unsigned> const & = std::vector<unsigned>(), bool = false);
     // Index from/to disk
     CGkArray(std::string const &);
     void save(std::string const &) const;
     ~CGkArray();
 
 private:
+    // Symbol of a packed k-mer or sequence: its 2-bit code, 4 for N and
+    // 5 for the '\0' that ends a packed sequence
+    struct PackedCode
+    {
+        explicit PackedCode(unsigned code_)
+            : code(code_)
+        { }
+        unsigned code;
+    };
+
     // Return C[c] + rank_c(L, i) for given c and i
     inline ulong LF(uchar c, ulong i) const
     {
+        QueryStats::lfSteps(1);
         if (C[(int)c+1]-C[(int)c] == 0) // FIXME fix alphabet
             return C[(int)c];
         return C[(int)c] + alphabetrank->rank(c, i);
     } 
 
+    // prev() and next() of the bit vectors, counted by QueryStats
+    static inline ulong prevOne(static_bitsequence *bs, ulong i)
+    {
+        QueryStats::bitvectorCall();
+        return bs->prev(i);
+    }
+    static inline ulong nextOne(static_bitsequence *bs, ulong i)
+    {
+        QueryStats::bitvectorCall();
+        return bs->next(i);
+    }
+
+    // Backward search step from [sp, ep] of P to the range of cP, returns 
+    // false if cP does not occur. Both ends are LF-mapped in one traversal.
+    inline bool backwardStep(uchar c, ulong &sp, ulong &ep) const
+    {
+        QueryStats::lfSteps(2);
+        if (C[(int)c+1] == C[(int)c])
+            return false;
+        ulong ranksp, rankep;
+        alphabetrank->rank(c, sp-1, ep, ranksp, rankep);
+        sp = C[(int)c] + ranksp;
+        ep = C[(int)c] + rankep - 1;
+        return sp <= ep;
+    }
+    // As above, with C and the Huffman code looked up by the packed code
+    inline bool backwardStep(PackedCode c, ulong &sp, ulong &ep) const
+    {
+        QueryStats::lfSteps(2);
+        if (!packedCount[c.code])
+            return false;
+        ulong ranksp, rankep;
+        alphabetrank->rankByCode(packedHuffCode[c.code], sp-1, ep, ranksp, rankep);
+        sp = packedC[c.code] + ranksp;
+        ep = packedC[c.code] + rankep - 1;
+        return sp <= ep;
+    }
+
+    // LF for the reverse BWT (C is the same for both directions)
+    inline ulong LFRev(uchar c, ulong i) const
+    {
+        QueryStats::lfSteps(1);
+        if (C[(int)c+1]-C[(int)c] == 0)
+            return C[(int)c];
+        return C[(int)c] + alphabetrankRev->rank(c, i);
+    } 
+
+    // Number of symbols smaller than c in wt[sp..ep]
+    inline ulong countSmaller(HuffWT const *wt, uchar c, ulong sp, ulong ep) const
+    {
+        ulong count = 0;
+        for (unsigned a = 0; a < c; ++a)
+            if (C[a+1] != C[a])
+                count += wt->rank(a, ep) - (sp ? wt->rank(a, sp-1) : 0);
+        return count;
+    }
+
+    // B_lcp and B_last of one k-mer length
+    struct KmerLayer
+    {
+        unsigned k;
+        static_bitsequence *Blcp;
+        static_bitsequence *Blast;
+        // Read number of each 1-bit of Blast, for the queries restricted
+        // to a range of reads. Null if Blast has no 1-bits.
+        static_sequence_wvtree_noptrs *Dlast;
+        static_bitsequence *BlcpRev; // Null if the index is not bidirectional
+    };
+
+    // Reporting a read from Dlast costs roughly as much as locating this
+    // many 1-bits of Blast, see reportReads()
+    static const ulong DLAST_REPORT_RATIO = 32;
+
+    // Return the layer of the given k-mer length (0 for the default)
+    KmerLayer const & layer(unsigned k) const
+    {
+        if (k == 0)
+            return layers[0];
+        for (std::vector<KmerLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+            if (it->k == k)
+                return *it;
+        throw std::runtime_error("CGkArray: k-mer length was not indexed.");
+    }
+
     // Helper method for Q1
-    position_vector reportReads(ulong sp, ulong ep) const
+    position_vector reportReads(KmerLayer const &kl, ulong sp, ulong ep) const
     {
-        unsigned nreads = Blast->rank1(ep)-Blast->rank1(sp-1);
-        position_vector pv;
-        pv.reserve(nreads+1);
-        while (sp < ep)
+        unsigned nreads = countReads(kl, sp, ep);
+        std::vector<ulong> sapos;
+        sapos.reserve(nreads);
+        for (unsigned i = 0; i < nreads; ++i)
         {
-            sp = Blast->next(sp);
-            pv.push_back(getPosition(sp++));
+            sp = nextOne(kl.Blast, sp);
+            sapos.push_back(sp++);
         }
+        position_vector pv;
+        locate(sapos, pv);
         return pv;
     }
 
+    // Throws if k does not fit into a packed_kmer
+    static inline void checkPackedLength(unsigned k)
+    {
+        if (k > MAX_PACKED_K)
+            throw std::runtime_error("CGkArray: packed k-mers hold at most 32 bases.");
+    }
+    // Symbols of a packed k-mer as packed codes, see packed_kmer
+    struct PackedKmerSymbols
+    {
+        PackedKmerSymbols(packed_kmer kmer_, packed_kmer nmask_, unsigned k_)
+            : kmer(kmer_), nmask(nmask_), k(k_)
+        { }
+        inline PackedCode operator[](unsigned i) const
+        {
+            unsigned shift = 2*(k-1-i);
+            if (nmask >> shift & 3)
+                return PackedCode(4);
+            return PackedCode(kmer >> shift & 3);
+        }
+        packed_kmer kmer;
+        packed_kmer nmask;
+        unsigned k;
+    };
+    // Symbols of a string or packed sequence, starting from the given offset
+    template <class Sequence>
+    struct OffsetSymbols
+    {
+        OffsetSymbols(Sequence const &seq_, ulong offset_)
+            : seq(seq_), offset(offset_)
+        { }
+        inline uchar operator[](ulong i) const
+        {
+            return seq[offset + i];
+        }
+        Sequence const &seq;
+        ulong offset;
+    };
+
+    // Backward search of the pattern p[0..l-1], p can be any type with an
+    // operator[] that returns ASCII symbols or packed codes.
+    template <class Pattern>
+    sa_range patternToSARange(Pattern const &, unsigned) const;
+    // Helper methods for moveLeft() on strings and packed sequences
+    template <class Sequence>
+    sa_range moveLeftPattern(internal_pointer &, Sequence const &, unsigned) const;
+
+    // Helper method for kmerToSARanges(): extends the range [sp, ep] of kmer[i..k-1] to the left
+    void approximateSearch(uchar const *, unsigned, ulong, ulong, unsigned,
+                           std::vector<unsigned> &, approximate_vector &) const;
+
+    /**
+     * Batched locate: resolves all given suffixes in lockstep.
+     *
+     * Input: SA positions in increasing order
+     * Output: Read number and position of each suffix, in the same order
+     */
+    void locate(std::vector<ulong> const &, position_vector &) const;
+
     // Helper method for Q2
-    inline unsigned countReads(ulong sp, ulong ep) const
+    inline unsigned countReads(KmerLayer const &kl, ulong sp, ulong ep) const
     {
-        return Blast->rank1(ep) - Blast->rank1(sp-1);
+        // rank1(-1) is not defined for all bit vector backends
+        return kl.Blast->rank1(ep) - (sp == 0 ? 0 : kl.Blast->rank1(sp-1));
     }
  
     // Required by getSuffix(), assuming DNA alphabet
@@ -385,32 +948,49 @@ private:
     static const uchar versionFlag;
     ulong n;
     unsigned samplerate;
+    // Sample rate of the inverse SA (positions)
+    unsigned isaSamplerate;
     unsigned C[256];
     ulong bwtEndPos;
     HuffWT *alphabetrank;
+    // C, symbol counts and Huffman codes of A, C, G, T, N and '\0' by packed code
+    unsigned packedC[6];
+    unsigned packedCount[6];
+    unsigned packedHuffCode[6];
 
-    static_bitsequence_brw32 * sampled;
-    static_bitsequence_brw32 * Blast;
-    static_bitsequence_brw32 * Blcp;
+    static_bitsequence * sampled;
+    // Default k-mer length, equal to layers[0].k
     unsigned gk;
+    // B_lcp and B_last of each indexed k-mer length, default first
+    std::vector<KmerLayer> layers;
     BlockArray * suffixes;
     BlockArray * positions;
-    CSA::DeltaVector * textStartPos;
+    // Text positions of the inverse SA samples if anchored to read ends, 
+    // otherwise null and positions are sampled at every isaSamplerate'th text position
+    static_bitsequence * isaSampled;
+    // Text start positions of the reads
+    ReadBoundary * readBoundary;
 
     // Total number of texts in the collection
     unsigned numberOfTexts;
     // Length of the longest text
     ulong maxTextLength;
+    // True if reads r and r + numberOfTexts/2 are reverse complements
+    bool bothStrands;
 
     // Array of document id's in the order of end-markers in BWT
     ArrayDoc *Doc;
 
+    // Reverse BWT, or null if the index is not bidirectional
+    HuffWT *alphabetrankRev;
+
     uchar * BWT(uchar *);
     void makewavelet(uchar *);
-    void maketables(bool);
-    void traverseBWT(uint *);
-    void traverseBWT(uint *, ulong, ulong, unsigned);
-    static_bitsequence_brw32 * buildBlcp();
+    void makePackedTables();
+    void maketables(bool, static_bitsequence_builder *, static_bitsequence_builder *, bool, bool);
+    void traverseBWT(HuffWT *, uint *, unsigned);
+    void traverseBWT(HuffWT *, uint *, ulong, ulong, unsigned, unsigned);
+    static_bitsequence * buildBlcp(HuffWT *, unsigned, static_bitsequence_builder *);
 
     /**
      * Count end-markers in given interval
@@ -429,4 +1009,24 @@ private:
 
 }; // class CGkArray
 
+// Symbols of a packed sequence as packed codes, see packed_sequence::operator[]
+template <>
+struct CGkArray::OffsetSymbols<CGkArray::packed_sequence>
+{
+    OffsetSymbols(packed_sequence const &seq_, ulong offset_)
+        : seq(seq_), offset(offset_)
+    { }
+    inline PackedCode operator[](ulong i) const
+    {
+        i += offset;
+        if (i >= seq.length)
+            return PackedCode(5);
+        if (!seq.nmask.empty() && (seq.nmask[i/64] >> (i%64) & 1))
+            return PackedCode(4);
+        return PackedCode((seq.bases[i/32] >> (62 - 2*(i%32))) & 3);
+    }
+    packed_sequence const &seq;
+    ulong offset;
+};
+
 #endif
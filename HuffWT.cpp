@@ -1,85 +1,10 @@
 #include "HuffWT.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 #include <queue>
 #include <vector>
 
-HuffWT::HuffWT(uchar *s, ulong n, TCodeEntry *codetable, unsigned level) 
-    :bitrank(0), left(0), right(0), codetable(0), ch(0), leaf(0), C(0), intervals(0)
-{
-    ch = s[0];
-    leaf = false;
-    this->codetable = codetable;
-    ulong *B = new ulong[n/W+1];
-    for (ulong i = 0; i < n/W+1; ++i)
-        B[i] = 0;
-    ulong sum=0,i;
-    for (i=0;i<n;i++) 
-        if (codetable[(int)s[i]].code & (1u << level)) {
-            Tools::SetField(B, 1, i, 1);
-            sum++;
-        }
-    if (sum==0 || sum==n) {
-        delete [] B;
-        delete [] s;
-	leaf = true;
-        return;
-    } 
-    uchar *sfirst, *ssecond;
-    sfirst = new uchar[n-sum];  // FIXME this could be done in-place?
-    ssecond = new uchar[sum];
-    unsigned j=0,k=0;
-    for (i=0;i<n;i++)
-        if (Tools::GetField(B,1,i)) ssecond[k++] = s[i];
-        else sfirst[j++] = s[i];
-    if (level == 0)
-        free(s);  /* Silly hack to make it compatible with C code (bcr-demo.c) FIXME */
-    else
-        delete [] s;
-    bitrank = new BitRank(B,n,true);
-    left = new HuffWT(sfirst,j,codetable,level+1); 
-    // sfirst was already deleted
-    right = new HuffWT(ssecond,k,codetable,level+1); 
-    // ssecond was already deleted
-}
-
-HuffWT::HuffWT(std::FILE *file, TCodeEntry *ct)
-    :bitrank(0), left(0), right(0), codetable(ct), ch(0), leaf(0)
-{
-    if (std::fread(&leaf, sizeof(bool), 1, file) != 1)
-        throw std::runtime_error("HuffWT: file read error (Rs).");
-    if (std::fread(&ch, sizeof(uchar), 1, file) != 1)
-        throw std::runtime_error("HuffWT: file read error (Rs).");
-
-    if (!leaf)
-    {
-        bitrank = new BitRank(file);
-        left = new HuffWT(file, ct);
-        right = new HuffWT(file, ct);
-    }
-}
-
-void HuffWT::save(std::FILE *file)
-{
-    if (std::fwrite(&leaf, sizeof(bool), 1, file) != 1)
-        throw std::runtime_error("HuffWT: file write error (Rs).");
-    if (std::fwrite(&ch, sizeof(uchar), 1, file) != 1)
-        throw std::runtime_error("HuffWT: file write error (Rs).");
-
-    if (!leaf)
-    {
-        bitrank->save(file);
-        left->save(file);
-        right->save(file);
-    }
-}
-
-
-HuffWT::~HuffWT() {
-    if (left) delete left;
-    if (right) delete right;
-    if (bitrank)   
-        delete bitrank;
-}
-
 class node 
 {
 private:
@@ -170,17 +95,152 @@ unsigned node::SetBit(unsigned x, unsigned pos, unsigned bit) {
       return x | (bit << pos);
 }
 
+HuffWT::HuffWT(TCodeEntry *ct)
+    : codetable(ct), nodes(0), nnodes(0), blocks(0), nblocks(0), C(0), intervals(0)
+{ 
+    buildNodes();
+    void *p = 0;
+    if (posix_memalign(&p, 64, (nblocks ? nblocks : 1) * BLOCK_WORDS * sizeof(ulong)) != 0)
+        throw std::bad_alloc();
+    blocks = (ulong *)p;
+}
+
+HuffWT::~HuffWT() {
+    delete [] nodes;
+    free(blocks);
+}
+
+/**
+ * Computes the node table in level order from the code table. A node
+ * holds the symbols that share a code prefix, and its length is the sum
+ * of their counts. The bit vectors of the internal nodes get consecutive
+ * runs of blocks, with one extra block so that rank(n-1) stays in range.
+ */
+void HuffWT::buildNodes()
+{
+    std::vector<std::vector<uchar> > symbols(1);
+    std::vector<unsigned> levels(1, 0);
+    for (unsigned c = 0; c < 256; ++c)
+        if (codetable[c].count)
+            symbols[0].push_back(c);
+
+    std::vector<Node> table;
+    nblocks = 0;
+    for (unsigned v = 0; v < symbols.size(); ++v)
+    {
+        Node node;
+        node.n = 0;
+        node.block = 0;
+        node.ones = 0;
+        node.child = 0;
+        node.ch = symbols[v].empty() ? 0 : symbols[v][0];
+        std::vector<uchar> left, right;
+        for (std::vector<uchar>::const_iterator it = symbols[v].begin(); it != symbols[v].end(); ++it)
+        {
+            node.n += codetable[*it].count;
+            if (codetable[*it].code & (1u << levels[v]))
+                right.push_back(*it);
+            else
+                left.push_back(*it);
+        }
+        if (symbols[v].size() > 1)
+        {
+            node.block = nblocks;
+            nblocks += node.n / BLOCK_BITS + 1;
+            node.child = symbols.size();
+            unsigned level = levels[v] + 1;
+            symbols.push_back(left);
+            symbols.push_back(right);
+            levels.push_back(level);
+            levels.push_back(level);
+        }
+        table.push_back(node);
+    }
+    nnodes = table.size();
+    nodes = new Node[nnodes];
+    std::copy(table.begin(), table.end(), nodes);
+}
+
+// Fills the rank words of all blocks
+void HuffWT::buildRank()
+{
+    for (unsigned v = 0; v < nnodes; ++v)
+    {
+        if (!nodes[v].child)
+            continue;
+        ulong total = 0;
+        ulong *b = blocks + nodes[v].block * BLOCK_WORDS;
+        for (ulong k = 0; k <= nodes[v].n / BLOCK_BITS; ++k, b += BLOCK_WORDS)
+        {
+            ulong counts = 0, ones = 0;
+            for (unsigned w = 0; w < DATA_WORDS; ++w)
+            {
+                counts |= ones << (9 * w);
+                ones += __builtin_popcountl(b[2 + w]);
+            }
+            b[0] = total;
+            b[1] = counts;
+            total += ones;
+        }
+    }
+    countOnes();
+}
+
+// Number of ones of each node from its last block
+void HuffWT::countOnes()
+{
+    for (unsigned v = 0; v < nnodes; ++v)
+    {
+        if (!nodes[v].child)
+            continue;
+        ulong const *b = blocks + (nodes[v].block + nodes[v].n / BLOCK_BITS) * BLOCK_WORDS;
+        nodes[v].ones = b[0];
+        for (unsigned w = 0; w < DATA_WORDS; ++w)
+            nodes[v].ones += __builtin_popcountl(b[2 + w]);
+    }
+}
+
 HuffWT * HuffWT::makeHuffWT(uchar *bwt, ulong n)
 {
     HuffWT::TCodeEntry * codetable = node::makecodetable(bwt,n);
-    return new HuffWT(bwt,n, codetable, 0);
+    HuffWT *wt = new HuffWT(codetable);
+    Node const *nodes = wt->nodes;
+    ulong *blocks = wt->blocks;
+    for (ulong i = 0; i < wt->nblocks * BLOCK_WORDS; ++i)
+        blocks[i] = 0;
+
+    // The symbols of each node arrive in BWT order, so a fill position
+    // per node places the bits of all levels in one pass over the BWT
+    std::vector<ulong> fill(wt->nnodes, 0);
+    for (ulong i = 0; i < n; ++i)
+    {
+        unsigned code = codetable[bwt[i]].code;
+        unsigned v = 0;
+        for (unsigned level = 0; nodes[v].child; ++level)
+        {
+            ulong j = fill[v]++;
+            if (code & (1u << level))
+            {
+                blocks[(nodes[v].block + j / BLOCK_BITS) * BLOCK_WORDS + 2 + (j % BLOCK_BITS) / W] |= 1lu << (j % W);
+                v = nodes[v].child + 1;
+            }
+            else
+                v = nodes[v].child;
+        }
+    }
+    free(bwt);  /* Silly hack to make it compatible with C code (bcr-demo.c) FIXME */
+    wt->buildRank();
+    return wt;
 }
 
 void HuffWT::save(HuffWT *wt,std::FILE *file)
 {
     for (unsigned i = 0; i < 256; ++i)
         wt->codetable[i].save(file);
-    wt->save(file);
+    if (std::fwrite(&wt->nblocks, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("HuffWT: file write error (number of blocks).");
+    if (std::fwrite(wt->blocks, sizeof(ulong), wt->nblocks * BLOCK_WORDS, file) != wt->nblocks * BLOCK_WORDS)
+        throw std::runtime_error("HuffWT: file write error (blocks).");
 }
 
 HuffWT * HuffWT::load(std::FILE *file)
@@ -188,7 +248,14 @@ HuffWT * HuffWT::load(std::FILE *file)
     TCodeEntry *ct = new HuffWT::TCodeEntry[ 256 ];
     for (unsigned i = 0; i < 256; ++i)
         ct[i].load(file);
-    return new HuffWT(file, ct);
+    HuffWT *wt = new HuffWT(ct);
+    ulong nblocks = 0;
+    if (std::fread(&nblocks, sizeof(ulong), 1, file) != 1 || nblocks != wt->nblocks)
+        throw std::runtime_error("HuffWT: file read error (number of blocks).");
+    if (std::fread(wt->blocks, sizeof(ulong), nblocks * BLOCK_WORDS, file) != nblocks * BLOCK_WORDS)
+        throw std::runtime_error("HuffWT: file read error (blocks).");
+    wt->countOnes();
+    return wt;
 }
 
 void HuffWT::deleteHuffWT(HuffWT *wt)
@@ -196,3 +263,128 @@ void HuffWT::deleteHuffWT(HuffWT *wt)
     delete [] wt->codetable;
     delete wt;
 }
+
+void HuffWT::getIntervals(unsigned v, ulong i, ulong j)
+{
+    Node const &node = nodes[v];
+    if (!node.child)
+    {
+        intervals[node.ch] = std::make_pair(C[(int)node.ch] + i, C[(int)node.ch] + j);
+        return;
+    }
+    ulong a1 = rank1(node, i-1);
+    ulong b1 = rank1(node, j)-1;
+    ulong a0 = i-a1;
+    ulong b0 = j-b1-1;
+    if (b1 >= a1)
+        getIntervals(node.child + 1, a1, b1);
+    if (b0 >= a0)
+        getIntervals(node.child, a0, b0);
+}
+
+ulong HuffWT::select(unsigned v, unsigned code, ulong i, unsigned level) const
+{
+    Node const &node = nodes[v];
+    if (!node.child)
+        return i-1;
+    if ((code & (1u<<level)) == 0)
+        return select0(node, select(node.child, code, i, level+1) + 1);
+    return select1(node, select(node.child + 1, code, i, level+1) + 1);
+}
+
+/**
+ * Last block of v with less than x ones (or zeros) before it, x > 0.
+ *
+ * Each probe of the search is a cache miss, so the search starts from
+ * the interpolated block and gallops to bracket the answer before the
+ * binary search. Bits of the BWT are spread evenly enough that only a 
+ * few blocks are probed.
+ */
+ulong HuffWT::selectBlock(Node const &v, ulong x, bool one) const
+{
+    ulong nb = v.n / BLOCK_BITS + 1;
+    ulong total = one ? v.ones : v.n - v.ones;
+    ulong l = total ? std::min(nb - 1, (ulong)((double)x * v.n / total / BLOCK_BITS)) : 0;
+    ulong r;
+    // Gallop to blockCount(l) < x <= blockCount(r), where r = nb is past the end
+    if (blockCount(v, l, one) < x)
+    {
+        ulong step = 1;
+        for (r = l + 1; r < nb && blockCount(v, r, one) < x; r = l + step)
+        {
+            l = r;
+            step *= 2;
+        }
+        if (r > nb)
+            r = nb;
+    }
+    else
+    {
+        ulong step = 1;
+        r = l;
+        for (l = r > step ? r - step : 0; blockCount(v, l, one) >= x; l = r > step ? r - step : 0)
+        {
+            r = l;
+            step *= 2;
+        }
+    }
+    while (r - l > 1)
+    {
+        ulong m = (l + r) / 2;
+        if (blockCount(v, m, one) < x)
+            l = m;
+        else
+            r = m;
+    }
+    return l;
+}
+
+// Position of the x'th one of v, or v.n if there is no such position
+ulong HuffWT::select1(Node const &v, ulong x) const
+{
+    if (x == 0)
+        return 0;
+    ulong l = selectBlock(v, x, true);
+    ulong const *b = blocks + (v.block + l) * BLOCK_WORDS;
+    x -= b[0];
+    for (unsigned w = 0; w < DATA_WORDS; ++w)
+    {
+        ulong word = b[2 + w];
+        unsigned ones = __builtin_popcountl(word);
+        if (ones < x)
+        {
+            x -= ones;
+            continue;
+        }
+        for (; x > 1; --x)
+            word &= word - 1;
+        ulong i = l * BLOCK_BITS + w * W + __builtin_ctzl(word);
+        return i < v.n ? i : v.n;
+    }
+    return v.n;
+}
+
+// Position of the x'th zero of v, or v.n if there is no such position
+ulong HuffWT::select0(Node const &v, ulong x) const
+{
+    if (x == 0)
+        return 0;
+    ulong l = selectBlock(v, x, false);
+    ulong const *b = blocks + (v.block + l) * BLOCK_WORDS;
+    x -= l * BLOCK_BITS - b[0];
+    for (unsigned w = 0; w < DATA_WORDS; ++w)
+    {
+        ulong word = ~b[2 + w];
+        unsigned zeros = __builtin_popcountl(word);
+        if (zeros < x)
+        {
+            x -= zeros;
+            continue;
+        }
+        for (; x > 1; --x)
+            word &= word - 1;
+        ulong i = l * BLOCK_BITS + w * W + __builtin_ctzl(word);
+        return i < v.n ? i : v.n;
+    }
+    return v.n;
+}
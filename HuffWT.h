@@ -2,12 +2,26 @@
 #define _HUFFWT_H_
 
 
-#include "BitRank.h"
+#include "Tools.h"
+#include "QueryStats.h"
 
 #include <cstdio>
 #include <stdexcept>
 #include <utility>
 
+/**
+ * Huffman-shaped wavelet tree of the BWT.
+ *
+ * The tree is stored flat. The bit vectors of the internal nodes are laid
+ * out in level order in one 64-byte aligned allocation. Each bit vector is
+ * a run of 64-byte blocks, and a block holds two rank words and six data
+ * words (384 bits), so that rank() and access() touch one cache line per
+ * level. The first rank word counts the ones of the node before the block;
+ * the second holds the counts of ones before each data word, 9 bits each.
+ *
+ * The node table (lengths, first blocks and children) is computed from the
+ * code table, so the blocks are saved and loaded as one piece.
+ */
 class HuffWT 
 {
 public:
@@ -39,18 +53,61 @@ public:
     };
 
 private:
-    BitRank *bitrank;
-    HuffWT *left;
-    HuffWT *right;
+    // Node of the level-order node table
+    struct Node
+    {
+        ulong n;        // Length of the bit vector
+        ulong block;    // First block of the bit vector
+        ulong ones;     // Number of ones in the bit vector
+        unsigned child; // Left child, the right child follows it; 0 for a leaf
+        uchar ch;       // Symbol of a leaf
+    };
+    static const unsigned BLOCK_WORDS = 8;          // 64 bytes: two rank words
+    static const unsigned DATA_WORDS = 6;           // and six data words
+    static const ulong BLOCK_BITS = DATA_WORDS * W; // Bits per block
+
     TCodeEntry *codetable;
-    uchar ch;
-    bool leaf;
+    Node *nodes;
+    unsigned nnodes;
+    ulong *blocks;
+    ulong nblocks;
     unsigned *C;
     std::pair<ulong, ulong> *intervals;
 
-    HuffWT(uchar *, ulong, TCodeEntry *, unsigned);
-    void save(std::FILE *);
-    HuffWT(std::FILE *, TCodeEntry *);
+    HuffWT(TCodeEntry *);
+    void buildNodes();
+    void buildRank();
+    void countOnes();
+    ulong selectBlock(Node const &, ulong, bool) const;
+    ulong select1(Node const &, ulong) const;
+    ulong select0(Node const &, ulong) const;
+    ulong select(unsigned, unsigned, ulong, unsigned) const;
+    void getIntervals(unsigned, ulong, ulong);
+    HuffWT(HuffWT const &);
+    HuffWT & operator=(HuffWT const &);
+
+    // Number of ones in v[0..i]; i = ~0 gives 0
+    inline ulong rank1(Node const &v, ulong i) const
+    {
+        ++i;
+        ulong const *b = blocks + (v.block + i / BLOCK_BITS) * BLOCK_WORDS;
+        unsigned j = i % BLOCK_BITS;
+        return b[0] + ((b[1] >> (9 * (j / W))) & 0x1ff)
+            + __builtin_popcountl(b[2 + j / W] & ((1lu << (j % W)) - 1));
+    }
+    // Number of ones (or zeros) in v before block k
+    inline ulong blockCount(Node const &v, ulong k, bool one) const
+    {
+        ulong ones = blocks[(v.block + k) * BLOCK_WORDS];
+        return one ? ones : k * BLOCK_BITS - ones;
+    }
+    inline bool isBitSet(Node const &v, ulong i) const
+    {
+        ulong const *b = blocks + (v.block + i / BLOCK_BITS) * BLOCK_WORDS;
+        unsigned j = i % BLOCK_BITS;
+        return (b[2 + j / W] >> (j % W)) & 1lu;
+    }
+
 public:
     static HuffWT * makeHuffWT(uchar *bwt, ulong n);
     static HuffWT * load(std::FILE *);
@@ -62,128 +119,139 @@ public:
     void setC(unsigned *C_)
     {
         C = C_;
-        if (left) left->setC(C_);
-        if (right) right->setC(C_);
     }
     // list needs to be an array of [0..255]
     void setList(std::pair<ulong, ulong> *list)
     {
         intervals = list;
-        if (left) left->setList(list);
-        if (right) right->setList(list);
     }
     // Updates the list of intervals. Let [i,j] be the interval of substring w.
     // Then the new intervals cover cw intervals for all symbols c.
     //  Beller et al. Computing the Longest Common Prefix Array Based on the {B}urrows-{W}heeler
     //  Transform. Proc. 18th Intl. Symp. String Processing and Information Retrieval, 2011.
     void getIntervals(ulong i, ulong j)
-    {        
-        if (leaf)
-        {
-            intervals[ch] = std::make_pair(C[(int)ch] + i, C[(int)ch] + j);
-            return;
-        }
-        ulong a1 = bitrank->rank(i-1);
-        ulong b1 = bitrank->rank(j)-1;
-        ulong a0 = i-a1;
-        ulong b0 = j-b1-1;
-        if (b1 >= a1)
-            right->getIntervals(a1,b1);
-        if (b0 >= a0)
-            left->getIntervals(a0,b0);
+    {
+        getIntervals(0, i, j);
     }
 
     inline ulong rank(uchar c, ulong i) const { // returns the number of characters c before and including position i
-        HuffWT const *temp=this;
+        QueryStats::rankCall();
         if (codetable[c].count == 0) return 0;
-        unsigned level = 0;
         unsigned code = codetable[c].code;
-        while (!temp->leaf) {
+        Node const *v = nodes;
+        for (unsigned level = 0; v->child; ++level) {
             if ((code & (1u<<level)) == 0) {
-                i = i-temp->bitrank->rank(i); 
-                temp = temp->left; 
+                i = i-rank1(*v, i); 
+                v = nodes + v->child;
             }
             else { 
-                i = temp->bitrank->rank(i)-1; 
-                temp = temp->right;
+                i = rank1(*v, i)-1; 
+                v = nodes + v->child + 1;
             }
-            ++level;
         } 
         return i+1;
     };   
 
-    inline ulong select(uchar c, ulong i, unsigned level = 0) const 
+    // Ranks of c at positions i and j (see rank() above) in one traversal,
+    // so that the blocks of both positions are loaded in parallel.
+    inline void rank(uchar c, ulong i, ulong j, ulong &ranki, ulong &rankj) const {
+        if (codetable[c].count == 0) {
+            QueryStats::rankCall();
+            QueryStats::rankCall();
+            ranki = rankj = 0;
+            return;
+        }
+        rankByCode(codetable[c].code, i, j, ranki, rankj);
+    }
+
+    // Huffman code of c, valid if c occurs
+    inline unsigned code(uchar c) const
     {
-        if (leaf)
-            return i-1;
+        return codetable[c].code;
+    }
 
-//        if (codetable[c].count == 0) return 0;
-//        unsigned level = 0;
-        unsigned code = codetable[c].code;
+    // As rank(c, i, j, ...) above for the code of an occurring symbol c
+    inline void rankByCode(unsigned code, ulong i, ulong j, ulong &ranki, ulong &rankj) const {
+        QueryStats::rankCall();
+        QueryStats::rankCall();
+        Node const *v = nodes;
+        for (unsigned level = 0; v->child; ++level) {
             if ((code & (1u<<level)) == 0) {
-                i = left->select(c, i, level+1);
-                i = bitrank->select0(i+1); 
+                i = i-rank1(*v, i); 
+                j = j-rank1(*v, j); 
+                v = nodes + v->child;
             }
-            else 
-            {
-                i = right->select(c, i, level+1);
-                i = bitrank->select(i+1); 
+            else { 
+                i = rank1(*v, i)-1; 
+                j = rank1(*v, j)-1; 
+                v = nodes + v->child + 1;
             }
-        return i;
-    };   
+        } 
+        ranki = i+1;
+        rankj = j+1;
+    }
 
-    inline bool IsCharAtPos(uchar c, ulong i) 
+    // Position of the i'th occurrence of c (i > 0)
+    inline ulong select(uchar c, ulong i) const 
+    {
+        QueryStats::selectCall();
+        return select(0, codetable[c].code, i, 0);
+    }
+
+    inline bool IsCharAtPos(uchar c, ulong i) const
     {
-        HuffWT const *temp=this;
         if (codetable[c].count == 0) return false;
-        unsigned level = 0;
         unsigned code = codetable[c].code;      
-        while (!temp->leaf) {
+        Node const *v = nodes;
+        for (unsigned level = 0; v->child; ++level) {
             if ((code & (1u<<level))==0) {
-                if (temp->bitrank->IsBitSet(i)) return false;
-                i = i-temp->bitrank->rank(i); 
-                    temp = temp->left; 
+                if (isBitSet(*v, i)) return false;
+                i = i-rank1(*v, i); 
+                v = nodes + v->child;
             }
             else { 
-                if (!temp->bitrank->IsBitSet(i)) return false;         
-                i = temp->bitrank->rank(i)-1; 
-                temp = temp->right;
+                if (!isBitSet(*v, i)) return false;         
+                i = rank1(*v, i)-1; 
+                v = nodes + v->child + 1;
             }
-            ++level;
         } 
         return true;
     }
     inline uchar access(ulong i) const 
     {
-        HuffWT const *temp=this;
-        while (!temp->leaf) {
-            if (temp->bitrank->IsBitSet(i)) {
-                i = temp->bitrank->rank(i)-1;
-                temp = temp->right;
-            }
-            else {
-                i = i-temp->bitrank->rank(i); 
-                temp = temp->left;      
-            }         
-        }
-        return (int)temp->ch;
+        ulong rank;
+        return access(i, rank);
+    }
+
+    // Hint the cache to load the root level block needed by access(i)
+    inline void prefetch(ulong i) const
+    {
+        if (nodes[0].child)
+            __builtin_prefetch(blocks + (nodes[0].block + (i+1) / BLOCK_BITS) * BLOCK_WORDS);
     }
 
     inline uchar access(ulong i, ulong &rank) const
     {
-        HuffWT const *temp=this;
-        while (!temp->leaf) {
-            if (temp->bitrank->IsBitSet(i)) {
-                i = temp->bitrank->rank(i)-1;
-                temp = temp->right;
+        QueryStats::accessCall();
+        Node const *v = nodes;
+        while (v->child) {
+            if (isBitSet(*v, i)) {
+                i = rank1(*v, i)-1;
+                v = nodes + v->child + 1;
             }
             else {
-                i = i-temp->bitrank->rank(i); 
-                temp = temp->left;      
+                i = i-rank1(*v, i); 
+                v = nodes + v->child;
             }         
         }
         rank = i+1;
-        return (int)temp->ch;
+        return v->ch;
+    }
+
+    // Size in bytes
+    ulong size() const
+    {
+        return sizeof(HuffWT) + 256 * sizeof(TCodeEntry) + nnodes * sizeof(Node) + nblocks * BLOCK_WORDS * sizeof(ulong);
     }
 };
 #endif
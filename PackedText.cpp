@@ -0,0 +1,113 @@
+#include "PackedText.h"
+
+#include <algorithm>
+
+// Include from RLCSA
+#include "bits/deltavector.h"
+
+namespace
+{
+    const unsigned READ_BUFFER = 1 << 20;  // Bytes per read() from the input
+    const unsigned DELTA_BLOCKSIZE = 16;   // DeltaEncoder block size, see builder.cpp
+}
+
+PackedText::PackedText(std::istream &is, ulong sizeHint)
+    : n(0), maxLength(0), bases(), excPos(), excSym(), boundaries(0)
+{
+    bases.reserve(sizeHint/32 + 1);
+    CSA::DeltaEncoder de(DELTA_BLOCKSIZE); // Collects text start positions
+    de.setBit(0);
+
+    char *buffer = new char[READ_BUFFER];
+    ulong word = 0;      // Codes of positions bases.size()*32 ...
+    unsigned curLength = 0;
+    bool terminated = true;
+    while (is.good())
+    {
+        is.read(buffer, READ_BUFFER);
+        std::streamsize len = is.gcount();
+        for (std::streamsize j = 0; j < len; ++j)
+        {
+            ulong code = 0;
+            switch (buffer[j])
+            {
+            case '\n':
+                // Terminator, coded as A
+                if (maxLength < curLength)
+                    maxLength = curLength;
+                curLength = 0;
+                de.setBit(n+1);
+                break;
+            case 'A': break;
+            case 'C': code = 1; break;
+            case 'G': code = 2; break;
+            case 'T': code = 3; break;
+            default:
+                excPos.push_back(n);
+                excSym.push_back(buffer[j]);
+            }
+            if (buffer[j] != '\n')
+                ++curLength;
+            terminated = buffer[j] == '\n';
+            word |= code << (2*(n%32));
+            if (++n % 32 == 0)
+            {
+                bases.push_back(word);
+                word = 0;
+            }
+        }
+    }
+    delete [] buffer;
+    if (!terminated)
+    {
+        // Terminate the last sequence
+        if (maxLength < curLength)
+            maxLength = curLength;
+        de.setBit(n+1);
+        if (++n % 32 == 0)
+        {
+            bases.push_back(word);
+            word = 0;
+        }
+    }
+    if (n % 32)
+        bases.push_back(word);
+    if (bases.capacity() > bases.size())
+        std::vector<ulong>(bases).swap(bases); // Shrink to fit
+
+    CSA::DeltaVector dv(de, n+1);
+    boundaries = new ReadBoundary(dv);
+}
+
+PackedText::~PackedText()
+{
+    delete boundaries;
+}
+
+bool PackedText::exceptionAt(ulong i, uchar &c) const
+{
+    std::vector<ulong>::const_iterator it = std::lower_bound(excPos.begin(), excPos.end(), i);
+    if (it == excPos.end() || *it != i)
+        return false;
+    c = excSym[it - excPos.begin()];
+    return true;
+}
+
+ulong PackedText::exceptionsBefore(ulong i) const
+{
+    return std::lower_bound(excPos.begin(), excPos.end(), i) - excPos.begin();
+}
+
+uchar PackedText::operator[](ulong i) const
+{
+    unsigned r = boundaries->read(i);
+    if (i == boundaries->start(r+1) - 1)
+        return '\0';
+    return symbol(i);
+}
+
+ulong PackedText::size() const
+{
+    return sizeof(PackedText) + bases.capacity() * sizeof(ulong)
+        + excPos.capacity() * sizeof(ulong) + excSym.capacity() + boundaries->size();
+}
@@ -0,0 +1,90 @@
+#ifndef _PACKEDTEXT_H_
+#define _PACKEDTEXT_H_
+#include "Tools.h"
+#include "ReadBoundary.h"
+#include <iostream>
+#include <vector>
+
+/**
+ * Input text of the builder packed two bits per symbol.
+ *
+ * The text is the concatenation of the reads, each followed by a '\0'
+ * terminator, as in the index. A, C, G and T take two bits each; other
+ * symbols (usually N) are stored in a sorted side list of exceptions,
+ * and the terminators are given by the read boundaries, which are
+ * built from the same DeltaVector that the builder stores as the map.
+ * The text takes a quarter of the memory of one byte per symbol.
+ */
+class PackedText
+{
+public:
+    // Reads the sequences separated by '\n' from the given stream. A last
+    // sequence without '\n' is terminated. The size hint (e.g. the file
+    // size) reserves the memory in advance.
+    explicit PackedText(std::istream &, ulong sizeHint = 0);
+    ~PackedText();
+
+    // Text length, including the terminators
+    inline ulong getLength() const
+    { return n; }
+
+    inline unsigned getNumberOfReads() const
+    { return boundaries->getNumberOfReads(); }
+
+    // Length of the longest read (excluding '\0')
+    inline unsigned getMaxReadLength() const
+    { return maxLength; }
+
+    inline ReadBoundary const & readBoundaries() const
+    { return *boundaries; }
+
+    // Number of symbols other than ACGT and '\0'
+    inline ulong getNumberOfExceptions() const
+    { return excPos.size(); }
+
+    // Symbol at position i, where i is not a terminator
+    inline uchar symbol(ulong i) const
+    {
+        uchar c = base(i);
+        if (!excPos.empty())
+            exceptionAt(i, c);
+        return c;
+    }
+
+    // Symbol at position i, '\0' at the terminators
+    uchar operator[](ulong i) const;
+
+    // Symbol at position i ignoring the exceptions, i.e. A for an N
+    inline uchar base(ulong i) const
+    {
+        return "ACGT"[(bases[i/32] >> (2*(i%32))) & 3];
+    }
+
+    // Position and symbol of the j'th exception, in increasing order of position
+    inline ulong exceptionPosition(ulong j) const
+    { return excPos[j]; }
+    inline uchar exceptionSymbol(ulong j) const
+    { return excSym[j]; }
+
+    // Number of exceptions before position i
+    ulong exceptionsBefore(ulong i) const;
+
+    // Size in bytes
+    ulong size() const;
+
+private:
+    ulong n;
+    unsigned maxLength;
+    std::vector<ulong> bases;  // Two bits per text position, A=0, C=1, G=2, T=3
+    std::vector<ulong> excPos; // Sorted positions of the other symbols
+    std::vector<uchar> excSym; // and the symbols
+    ReadBoundary *boundaries;  // Built from the DeltaVector of read starts
+
+    // Replaces c by the exception symbol if i has one
+    bool exceptionAt(ulong i, uchar &c) const;
+
+    PackedText(PackedText const &);
+    PackedText & operator=(PackedText const &);
+};
+
+#endif
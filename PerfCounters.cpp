@@ -0,0 +1,128 @@
+#include "PerfCounters.h"
+
+#ifdef PERF_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+char const * const PerfCounters::NAMES[PerfCounters::NEVENTS] = { "cycles", "instructions", "llc_misses", "dtlb_misses" };
+
+#ifdef PERF_COUNTERS
+namespace
+{
+    // Opens a disabled user space counter of the calling thread, returns -1 on failure
+    int openCounter(unsigned type, unsigned long long config)
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+    for (unsigned e = 0; e < NEVENTS; ++e)
+    {
+        fd[e] = -1;
+        count[e] = 0;
+        startTimes[e][0] = startTimes[e][1] = 0;
+    }
+#ifdef PERF_COUNTERS
+    fd[CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fd[INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fd[LLC_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                                 | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    if (fd[LLC_MISSES] < 0) // Generic event, usually LLC misses
+        fd[LLC_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fd[DTLB_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+                                  | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef PERF_COUNTERS
+    for (unsigned e = 0; e < NEVENTS; ++e)
+        if (fd[e] >= 0)
+            close(fd[e]);
+#endif
+}
+
+bool PerfCounters::anyAvailable() const
+{
+    for (unsigned e = 0; e < NEVENTS; ++e)
+        if (fd[e] >= 0)
+            return true;
+    return false;
+}
+
+bool PerfCounters::compiledIn()
+{
+#ifdef PERF_COUNTERS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef PERF_COUNTERS
+    for (unsigned e = 0; e < NEVENTS; ++e)
+        if (fd[e] >= 0)
+        {
+            // The reset clears only the count, the times keep accumulating
+            ioctl(fd[e], PERF_EVENT_IOC_RESET, 0);
+            unsigned long long v[3];
+            if (read(fd[e], v, sizeof(v)) == sizeof(v))
+            {
+                startTimes[e][0] = v[1];
+                startTimes[e][1] = v[2];
+            }
+            ioctl(fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef PERF_COUNTERS
+    for (unsigned e = 0; e < NEVENTS; ++e)
+        if (fd[e] >= 0)
+            ioctl(fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    for (unsigned e = 0; e < NEVENTS; ++e)
+    {
+        if (fd[e] < 0)
+            continue;
+        // Value, time enabled and time running
+        unsigned long long v[3];
+        if (read(fd[e], v, sizeof(v)) != sizeof(v))
+            continue;
+        // Scale by the times of this phase only
+        v[1] -= startTimes[e][0];
+        v[2] -= startTimes[e][1];
+        if (v[2] == 0)
+            continue; // Never scheduled on the PMU
+        if (v[2] < v[1])
+            v[0] = (unsigned long long)((double)v[0] * v[1] / v[2]);
+        count[e] += v[0];
+    }
+#endif
+}
+
+void PerfCounters::reset()
+{
+    for (unsigned e = 0; e < NEVENTS; ++e)
+        count[e] = 0;
+}
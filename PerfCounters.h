@@ -0,0 +1,56 @@
+#ifndef _PERFCOUNTERS_H_
+#define _PERFCOUNTERS_H_
+#include "Tools.h"
+
+/**
+ * Hardware performance counters of the calling thread.
+ *
+ * Counts CPU cycles, instructions, last level cache misses and dTLB
+ * misses in user space between start() and stop(), accumulating over
+ * several start()/stop() pairs. Counters are opened by perf_event_open
+ * and are compiled in only with -DPERF_COUNTERS (see Makefile).
+ *
+ * Each counter is opened separately, so a counter that is not supported
+ * (e.g. no dTLB events in a virtual machine, or perf_event_paranoid too
+ * high) is reported as unavailable while the others still count. Without
+ * -DPERF_COUNTERS all counters are unavailable and the calls do nothing.
+ */
+class PerfCounters
+{
+public:
+    enum event { CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, NEVENTS };
+    static char const * const NAMES[NEVENTS];
+
+    PerfCounters();
+    ~PerfCounters();
+
+    void start();
+    void stop();
+    void reset();
+
+    // True if the counter could be opened
+    bool available(event e) const
+    {
+        return fd[e] >= 0;
+    }
+    // True if any counter could be opened
+    bool anyAvailable() const;
+    // True if compiled with -DPERF_COUNTERS
+    static bool compiledIn();
+    // Accumulated count, scaled up if the counter was multiplexed
+    ulong value(event e) const
+    {
+        return count[e];
+    }
+
+private:
+    int fd[NEVENTS];
+    ulong count[NEVENTS];
+    // Time enabled and time running read by start()
+    ulong startTimes[NEVENTS][2];
+
+    PerfCounters(PerfCounters const &);
+    PerfCounters & operator=(PerfCounters const &);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _QUERYSTATS_H_
+#define _QUERYSTATS_H_
+#include "Tools.h"
+
+/**
+ * Operation counts of the queries, see QueryStatsPolicy.
+ */
+struct QueryStatsCounts
+{
+    ulong lfSteps;        // LF-mappings, incl. both ends of backward search ranges
+    ulong rankCalls;      // HuffWT::rank()
+    ulong accessCalls;    // HuffWT::access()
+    ulong selectCalls;    // HuffWT::select()
+    ulong bitvectorCalls; // prev() and next() of B_lcp, B_last and the samples
+    ulong locates;        // Suffixes resolved to text positions
+    ulong locateSteps;    // Total walk length to the sampled suffixes
+    ulong maxLocateSteps; // Longest walk to a sampled suffix
+};
+
+/**
+ * Compile-time policy for counting query operations.
+ *
+ * The index calls the static hooks below at each operation. The default
+ * policy has empty hooks that compile away; with -DQUERY_STATS the counting
+ * policy accumulates the counts per thread, so that the queries stay
+ * const and thread-safe. Use get() and reset() around a query to obtain
+ * its cost, e.g. the distance of getPosition() to a sampled suffix.
+ */
+template <bool Enabled>
+struct QueryStatsPolicy
+{
+    static const bool enabled = false;
+    static inline void lfSteps(ulong) { }
+    static inline void rankCall() { }
+    static inline void accessCall() { }
+    static inline void selectCall() { }
+    static inline void bitvectorCall() { }
+    static inline void locateWalk(ulong) { }
+    static inline QueryStatsCounts get()
+    {
+        QueryStatsCounts c = QueryStatsCounts();
+        return c;
+    }
+    static inline void reset() { }
+};
+
+template <>
+struct QueryStatsPolicy<true>
+{
+    static const bool enabled = true;
+    static inline void lfSteps(ulong s) { counts().lfSteps += s; }
+    static inline void rankCall() { ++counts().rankCalls; }
+    static inline void accessCall() { ++counts().accessCalls; }
+    static inline void selectCall() { ++counts().selectCalls; }
+    static inline void bitvectorCall() { ++counts().bitvectorCalls; }
+    static inline void locateWalk(ulong dist)
+    {
+        QueryStatsCounts &c = counts();
+        ++c.locates;
+        c.locateSteps += dist;
+        if (dist > c.maxLocateSteps)
+            c.maxLocateSteps = dist;
+    }
+    static inline QueryStatsCounts get()
+    {
+        return counts();
+    }
+    static inline void reset()
+    {
+        counts() = QueryStatsCounts();
+    }
+private:
+    static inline QueryStatsCounts & counts()
+    {
+        static __thread QueryStatsCounts c;
+        return c;
+    }
+};
+
+#ifdef QUERY_STATS
+typedef QueryStatsPolicy<true> QueryStats;
+#else
+typedef QueryStatsPolicy<false> QueryStats;
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+/******************************************************************************
+ *                                                                            *
+ *   This program is free software; you can redistribute it and/or modify     *
+ *   it under the terms of the GNU Lesser General Public License as published *
+ *   by the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                      *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU Lesser General Public License for more details.                      *
+ *                                                                            *
+ *   You should have received a copy of the GNU Lesser General Public License *
+ *   along with this program; if not, write to the                            *
+ *   Free Software Foundation, Inc.,                                          *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.            *
+ *****************************************************************************/
+#include "ReadBoundary.h"
+
+#include <cassert>
+
+ReadBoundary::ReadBoundary(CSA::DeltaVector const &dv)
+    : n(0), m(0), fixedLength(0), lowBits(0), low(0), highLength(0), high(0),
+      select1Samples(0), select0Samples(0)
+{
+    // The map has a bit for each read start plus one for the end of the text
+    n = dv.getSize() - 1;
+    m = dv.getNumberOfItems() - 1;
+    ulong *starts = new ulong[m+1];
+    {
+        CSA::DeltaVector::Iterator iter(dv);
+        starts[0] = iter.select(0);
+        for (unsigned i = 1; i <= m; ++i)
+            starts[i] = iter.selectNext();
+    }
+    assert(starts[0] == 0);
+    assert(starts[m] == n);
+
+    // Fast path for reads of equal length
+    fixedLength = m ? starts[1] : 0;
+    for (unsigned i = 1; i <= m && fixedLength; ++i)
+        if (starts[i] - starts[i-1] != fixedLength)
+            fixedLength = 0;
+    if (fixedLength)
+    {
+        delete [] starts;
+        return;
+    }
+
+    if (n / (m+1) > 1)
+        lowBits = Tools::FloorLog2(n / (m+1));
+    if (lowBits)
+    {
+        low = new ulong[(ulong)(m+1)*lowBits/W+1];
+        for (ulong i = 0; i < (ulong)(m+1)*lowBits/W+1; ++i)
+            low[i] = 0;
+    }
+
+    // One 1-bit per start position and one 0-bit per bucket
+    highLength = (n >> lowBits) + 1 + (m+1);
+    high = new ulong[highLength/W+1];
+    for (ulong i = 0; i < highLength/W+1; ++i)
+        high[i] = 0;
+    ulong nsamples1 = ((m+1) >> selectShift) + 1;
+    ulong nsamples0 = (((n >> lowBits) + 1) >> selectShift) + 1;
+    select1Samples = new ulong[nsamples1];
+    select0Samples = new ulong[nsamples0];
+
+    ulong pos = 0, ones = 0, zeros = 0;
+    for (unsigned i = 0; i <= m; ++i)
+    {
+        if (lowBits)
+            Tools::SetField(low, lowBits, i, starts[i] & ((1lu << lowBits) - 1));
+        ulong h = starts[i] >> lowBits;
+        for (; zeros < h; ++zeros, ++pos)
+            if (zeros % (1lu << selectShift) == 0)
+                select0Samples[zeros >> selectShift] = pos;
+        if (ones % (1lu << selectShift) == 0)
+            select1Samples[ones >> selectShift] = pos;
+        high[pos/W] |= 1lu << (pos%W);
+        ++ones;
+        ++pos;
+    }
+    // Terminate the remaining buckets
+    for (; pos < highLength; ++zeros, ++pos)
+        if (zeros % (1lu << selectShift) == 0)
+            select0Samples[zeros >> selectShift] = pos;
+    delete [] starts;
+}
+
+ReadBoundary::~ReadBoundary()
+{
+    delete [] low;
+    delete [] high;
+    delete [] select1Samples;
+    delete [] select0Samples;
+}
+
+ulong ReadBoundary::select1(ulong x) const
+{
+    ulong k = (x-1) >> selectShift;
+    ulong pos = select1Samples[k];
+    // Count the sampled one itself, and skip the rest word by word
+    ulong r = x - (k << selectShift);
+    ulong w = pos / W;
+    ulong word = high[w] & (~0lu << (pos % W));
+    unsigned c = __builtin_popcountl(word);
+    while (c < r)
+    {
+        r -= c;
+        word = high[++w];
+        c = __builtin_popcountl(word);
+    }
+    for (; r > 1; --r)
+        word &= word - 1;
+    return w * W + __builtin_ctzl(word);
+}
+
+ulong ReadBoundary::select0(ulong x) const
+{
+    ulong k = (x-1) >> selectShift;
+    ulong pos = select0Samples[k];
+    ulong r = x - (k << selectShift);
+    ulong w = pos / W;
+    ulong word = ~high[w] & (~0lu << (pos % W));
+    unsigned c = __builtin_popcountl(word);
+    while (c < r)
+    {
+        r -= c;
+        word = ~high[++w];
+        c = __builtin_popcountl(word);
+    }
+    for (; r > 1; --r)
+        word &= word - 1;
+    return w * W + __builtin_ctzl(word);
+}
+
+ulong ReadBoundary::size() const
+{
+    ulong s = sizeof(ReadBoundary);
+    if (fixedLength)
+        return s;
+    s += ((ulong)(m+1)*lowBits/W+1) * sizeof(ulong);
+    s += (highLength/W+1) * sizeof(ulong);
+    s += (((m+1) >> selectShift) + 1) * sizeof(ulong);
+    s += ((((n >> lowBits) + 1) >> selectShift) + 1) * sizeof(ulong);
+    return s;
+}
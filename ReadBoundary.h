@@ -0,0 +1,112 @@
+/******************************************************************************
+ *                                                                            *
+ *   This program is free software; you can redistribute it and/or modify     *
+ *   it under the terms of the GNU Lesser General Public License as published *
+ *   by the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                      *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU Lesser General Public License for more details.                      *
+ *                                                                            *
+ *   You should have received a copy of the GNU Lesser General Public License *
+ *   along with this program; if not, write to the                            *
+ *   Free Software Foundation, Inc.,                                          *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.            *
+ *****************************************************************************/
+
+#ifndef _READBOUNDARY_H_
+#define _READBOUNDARY_H_
+#include "Tools.h"
+
+// Include from RLCSA
+#include "bits/deltavector.h"
+
+/**
+ * Read boundaries of the concatenated text.
+ *
+ * Stores the start positions of the reads (plus the end of the text) as
+ * an Elias-Fano encoded sequence: the low bits of each start position
+ * are stored verbatim, the high bits in unary into a bit vector.
+ * Every 2^selectShift'th one and zero of the unary part is sampled,
+ * so that select1() and select0() scan only a few words.
+ *
+ * If all reads have the same length, nothing is stored and the
+ * conversions are plain arithmetic.
+ */
+class ReadBoundary
+{
+private:
+    static const unsigned selectShift = 8; // Sample every 256th one/zero
+
+    ulong n;           // Total length of the text
+    unsigned m;        // Number of reads
+    ulong fixedLength; // Read length (incl. '\0'), or 0 if reads vary in length
+
+    unsigned lowBits;  // Number of low bits per start position
+    ulong *low;        // m+1 fields of lowBits bits
+    ulong highLength;  // Length of the unary part in bits
+    ulong *high;       // Unary coded high bits
+    ulong *select1Samples;
+    ulong *select0Samples;
+
+    ulong select1(ulong) const; // Position of the x'th one (x > 0)
+    ulong select0(ulong) const; // Position of the x'th zero (x > 0)
+    ReadBoundary(ReadBoundary const &);
+    ReadBoundary & operator=(ReadBoundary const &);
+public:
+    // Start positions are given as the RLCSA map stored by builder.
+    ReadBoundary(CSA::DeltaVector const &);
+    ~ReadBoundary();
+
+    // Return the text position where the given read starts,
+    // start(getNumberOfReads()) returns the total length of the text.
+    inline ulong start(unsigned read) const
+    {
+        if (fixedLength)
+            return read * fixedLength;
+        ulong x = lowBits ? Tools::GetField(low, lowBits, read) : 0;
+        return ((select1(read+1) - read) << lowBits) | x;
+    }
+
+    // Return the read number that covers text position i
+    inline unsigned read(ulong i) const
+    {
+        if (fixedLength)
+            return i / fixedLength;
+
+        // Reads in the bucket of i start after the h'th zero
+        ulong h = i >> lowBits;
+        ulong pos = h ? select0(h) + 1 : 0;
+        ulong j = pos - h; // Number of reads in earlier buckets
+        ulong x = i & ((1lu << lowBits) - 1);
+        while (pos < highLength && (high[pos/W] >> (pos%W)) & 1lu
+               && (lowBits ? Tools::GetField(low, lowBits, j) : 0) <= x)
+        {
+            ++j;
+            ++pos;
+        }
+        return j - 1;
+    }
+
+    // Return the length of the given read (including '\0')
+    inline ulong length(unsigned read) const
+    {
+        if (fixedLength)
+            return fixedLength;
+        return start(read+1) - start(read);
+    }
+
+    // Return the read length if all reads are of equal length, 0 otherwise
+    inline ulong getFixedLength() const
+    { return fixedLength; }
+
+    inline unsigned getNumberOfReads() const
+    { return m; }
+
+    // Size in bytes
+    ulong size() const;
+};
+
+#endif
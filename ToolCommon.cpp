@@ -0,0 +1,52 @@
+/*
+ * Common code of the command line tools
+ */
+
+#include "ToolCommon.h"
+
+#include <iostream>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
+
+FILE * ToolCommon::OpenOutput(char const *name, char const *filename)
+{
+    if (!filename)
+        return stdout;
+    FILE *fp = std::fopen(filename, "wb");
+    if (!fp)
+        std::cerr << name << ": unable to write " << filename << std::endl;
+    return fp;
+}
+
+bool ToolCommon::WriteBuffer(FILE *fp, std::vector<char> &buffer)
+{
+    bool ok = buffer.empty() || std::fwrite(&buffer[0], 1, buffer.size(), fp) == buffer.size();
+    buffer.clear();
+    return ok;
+}
+
+bool ToolCommon::CloseOutput(FILE *fp)
+{
+    // Also catches errors of earlier writes and flushes
+    bool ok = !std::ferror(fp);
+    if (fp == stdout)
+        return std::fflush(fp) == 0 && ok;
+    return std::fclose(fp) == 0 && ok;
+}
+
+unsigned ToolCommon::SetThreads(char const *name, unsigned threads, bool verbose)
+{
+#ifdef PARALLEL_SUPPORT
+    if (threads != 0)
+        omp_set_num_threads(threads);
+    threads = omp_get_max_threads();
+    if (verbose)
+        std::cerr << "Using " << threads << " threads." << std::endl;
+    return threads;
+#else
+    if (threads != 0)
+        std::cerr << name << ": warning: compiled without parallel support, ignoring -t" << std::endl;
+    return 1;
+#endif
+}
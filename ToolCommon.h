@@ -0,0 +1,31 @@
+/*
+ * Common code of the command line tools (cgkcoverage, cgkspectrum etc.)
+ *
+ * Not part of the index library: ToolCommon.cpp is compiled with the
+ * OpenMP flags of the tools, see the Makefile.
+ */
+
+#ifndef _TOOLCOMMON_H_
+#define _TOOLCOMMON_H_
+
+#include <cstdio>
+#include <vector>
+
+class ToolCommon
+{
+public:
+    // Opens the output file, or returns stdout if the filename is null.
+    // Prints an error and returns null if the file cannot be opened.
+    static FILE * OpenOutput(char const *, char const *);
+    // Writes the buffer and clears it, returns false on write error
+    static bool WriteBuffer(FILE *, std::vector<char> &);
+    // Closes the output file, or flushes stdout; returns false if any
+    // write to the output failed
+    static bool CloseOutput(FILE *);
+
+    // Sets the number of threads given by option -t, 0 uses all cores.
+    // Returns the number of threads.
+    static unsigned SetThreads(char const *, unsigned, bool);
+};
+
+#endif
@@ -84,6 +84,23 @@ uchar * Tools::GetFileContents(char *filename, ulong maxSize)
         return 0;
 }
 
+/**
+ * Writes the reverse complement of src[0..n-1] into dest[0..n-1].
+ * Symbols other than A, C, G and T are complemented to N.
+ */
+void Tools::ReverseComplement(uchar *dest, uchar const *src, ulong n)
+{
+    for (ulong i = 0; i < n; ++i)
+        switch (src[n - i - 1])
+        {
+        case 'A': dest[i] = 'T'; break;
+        case 'T': dest[i] = 'A'; break;
+        case 'C': dest[i] = 'G'; break;
+        case 'G': dest[i] = 'C'; break;
+        default:  dest[i] = 'N'; break;
+        }
+}
+
 unsigned Tools::bits (ulong n)
 
    { unsigned b = 0;
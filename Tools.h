@@ -45,6 +45,7 @@ public:
     static unsigned FloorLog2(ulong);
     static unsigned CeilLog2(ulong);
     static unsigned bits (ulong);
+    static void ReverseComplement(uchar *, uchar const *, ulong);
 
     static inline void SetField(ulong *A, register unsigned len, register ulong index, register ulong x) 
     {
@@ -11,10 +11,109 @@
 #include <stdio.h>
 #include "bcr-demo.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(BCR_NO_SIMD)
+#define BCR_X86_SIMD
+#include <immintrin.h>
+#endif
+
 typedef struct {
 	uint64_t u, v;
 } pair64_t;
 
+/**
+ * Copying a span of the BWT and counting its symbols.
+ *
+ * copy_count() copies $len symbols from $p to $q, where $q <= $p and the
+ * spans may overlap, and adds their counts to $mc. The vectorized versions
+ * compare 16 or 32 symbols at a time against the common symbols 0, A, C, G
+ * and T, accumulating the counts in bytes; other symbols are counted one at
+ * a time. The version is selected at runtime by the CPU features;
+ * -DBCR_NO_SIMD leaves only the scalar version.
+ */
+typedef void (*copy_count_f)(uint8_t *q, const uint8_t *p, long len, long *mc);
+
+#define BCR_SIMD_MIN 32 // shorter spans are copied by the scalar loop
+
+static void copy_count_scalar(uint8_t *q, const uint8_t *p, long len, long *mc)
+{
+	long l;
+	for (l = 0; l < len; ++l)
+		++mc[p[l]], q[l] = p[l];
+}
+
+#ifdef BCR_X86_SIMD
+static const uint8_t bcr_common[5] = { 0, 'A', 'C', 'G', 'T' };
+
+static void copy_count_sse2(uint8_t *q, const uint8_t *p, long len, long *mc)
+{
+	__m128i v[5], acc[5], t;
+	long l = 0, m;
+	int s;
+	for (s = 0; s < 5; ++s) v[s] = _mm_set1_epi8((char)bcr_common[s]);
+	while (len - l >= 16) {
+		for (s = 0; s < 5; ++s) acc[s] = _mm_setzero_si128();
+		for (m = 0; m < 255 && len - l >= 16; ++m, l += 16) { // byte counters overflow after 255 rounds
+			__m128i x = _mm_loadu_si128((const __m128i*)(p + l)), any = _mm_setzero_si128();
+			unsigned other;
+			_mm_storeu_si128((__m128i*)(q + l), x); // never overwrites the unread part of $p as $q <= $p
+			for (s = 0; s < 5; ++s) {
+				__m128i e = _mm_cmpeq_epi8(x, v[s]);
+				acc[s] = _mm_sub_epi8(acc[s], e);
+				any = _mm_or_si128(any, e);
+			}
+			for (other = ~_mm_movemask_epi8(any) & 0xffff; other; other &= other - 1)
+				++mc[q[l + __builtin_ctz(other)]];
+		}
+		for (s = 0; s < 5; ++s) {
+			t = _mm_sad_epu8(acc[s], _mm_setzero_si128());
+			mc[bcr_common[s]] += _mm_cvtsi128_si32(t) + _mm_cvtsi128_si32(_mm_srli_si128(t, 8));
+		}
+	}
+	copy_count_scalar(q + l, p + l, len - l, mc);
+}
+
+__attribute__((target("avx2")))
+static void copy_count_avx2(uint8_t *q, const uint8_t *p, long len, long *mc)
+{
+	__m256i v[5], acc[5];
+	__m128i t;
+	long l = 0, m;
+	int s;
+	for (s = 0; s < 5; ++s) v[s] = _mm256_set1_epi8((char)bcr_common[s]);
+	while (len - l >= 32) {
+		for (s = 0; s < 5; ++s) acc[s] = _mm256_setzero_si256();
+		for (m = 0; m < 255 && len - l >= 32; ++m, l += 32) {
+			__m256i x = _mm256_loadu_si256((const __m256i*)(p + l)), any = _mm256_setzero_si256();
+			unsigned other;
+			_mm256_storeu_si256((__m256i*)(q + l), x);
+			for (s = 0; s < 5; ++s) {
+				__m256i e = _mm256_cmpeq_epi8(x, v[s]);
+				acc[s] = _mm256_sub_epi8(acc[s], e);
+				any = _mm256_or_si256(any, e);
+			}
+			for (other = ~(unsigned)_mm256_movemask_epi8(any); other; other &= other - 1)
+				++mc[q[l + __builtin_ctz(other)]];
+		}
+		for (s = 0; s < 5; ++s) {
+			__m256i u = _mm256_sad_epu8(acc[s], _mm256_setzero_si256());
+			t = _mm_add_epi64(_mm256_castsi256_si128(u), _mm256_extracti128_si256(u, 1));
+			mc[bcr_common[s]] += _mm_cvtsi128_si32(t) + _mm_cvtsi128_si32(_mm_srli_si128(t, 8));
+		}
+	}
+	copy_count_sse2(q + l, p + l, len - l, mc);
+}
+#endif
+
+static copy_count_f select_copy_count(void)
+{
+#ifdef BCR_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return copy_count_avx2;
+	if (__builtin_cpu_supports("sse2")) return copy_count_sse2;
+#endif
+	return copy_count_scalar;
+}
+
 static const uint8_t **split_str(long Tlen, const uint8_t *T, long *n_)
 {
 	long n, max;
@@ -34,6 +133,12 @@ static const uint8_t **split_str(long Tlen, const uint8_t *T, long *n_)
 	return P;
 }
 
+static uint8_t str_symbol(void *data, long k, long i)
+{
+	const uint8_t **P = (const uint8_t **)data;
+	return P[k + 1] - 2 - i >= P[k]? *(P[k + 1] - 2 - i) : 0;
+}
+
 /**
  * Append $T to existing BWT $B.
  *
@@ -46,17 +151,44 @@ static const uint8_t **split_str(long Tlen, const uint8_t *T, long *n_)
  */
 uint8_t *bcr_lite(long Blen, uint8_t *B, long Tlen, const uint8_t *T)
 {
-	long i, k, n, n0;
+	long n;
+	const uint8_t **P;
+
+	if (T == 0 || Tlen == 0) return B;
+	P = split_str(Tlen, T, &n);
+	B = bcr_lite_seq(Blen, B, Tlen, n, str_symbol, P);
+	free(P);
+	return B;
+}
+
+/**
+ * Append $n sequences to existing BWT $B, reading the symbols through a
+ * callback, e.g. from a packed text.
+ *
+ * @param Blen    length of the existing BWT
+ * @param B       existing BWT; set to NULL if non-existing
+ * @param Tlen    total length of the sequences, including a sentinel each
+ * @param n       number of sequences
+ * @param symbol  returns the symbols of the sequences from their end
+ * @param data    passed to $symbol
+ *
+ * @return  the new BWT string
+ */
+uint8_t *bcr_lite_seq(long Blen, uint8_t *B, long Tlen, long n, bcr_symbol_f symbol, void *data)
+{
+	long i, k, n0;
 	uint8_t *p, *q, *B0;
-	const uint8_t *end, **P;
-	pair64_t *a;
+	const uint8_t *end;
+	pair64_t *a, *aa;
 	int c;
+	copy_count_f copy_count;
 
-	if (T == 0 || Tlen == 0) return B;
+	if (n == 0 || Tlen == 0) return B;
 	// initialize
-	P = split_str(Tlen, T, &n);
+	copy_count = select_copy_count();
 	for (p = B, end = B + Blen, i = 0; p < end; ++p) i += (*p == 0); // count # of sentinels
 	a = malloc(sizeof(pair64_t) * n);
+	aa = malloc(sizeof(pair64_t) * n); // buffer of the counting sort, swapped with $a in each round
 	for (k = 0; k < n; ++k) a[k].u = k + i, a[k].v = k<<8;
 	B = realloc(B, Blen + Tlen);
 	memmove(B + Tlen, B, Blen); // finished BWT is always placed at the end of $B
@@ -64,31 +196,36 @@ uint8_t *bcr_lite(long Blen, uint8_t *B, long Tlen, const uint8_t *T)
 	// core loop
 	for (i = 0, n0 = n; n0; ++i) {
 		long l, pre, ac[256], mc[256], mc2[256];
-		pair64_t *b[256], *aa;
+		pair64_t *b[256], *t;
 		for (c = 0; c != 256; ++c) mc[c] = mc2[c] = 0;
 		end = B0 + Blen; Blen += n0; B -= n0;
 		for (n = k = 0, p = B0, q = B, pre = 0; k < n0; ++k) {
 			pair64_t *u = &a[k];
-			c = P[(u->v>>8) + 1] - 2 - i >= P[u->v>>8]? *(P[(u->v>>8) + 1] - 2 - i) : 0; // symbol to insert
+			c = symbol(data, u->v>>8, i); // symbol to insert
 			u->v = (u->v&~0xffULL) | c;
-			for (l = 0; l != u->u - pre; ++l) // copy ($u->u - $pre - 1) symbols from B0 to B
-				++mc[*p], *q++ = *p++; // $mc: marginal counts of all processed symbols
+			l = u->u - pre; // copy ($u->u - $pre - 1) symbols from B0 to B
+			if (l < BCR_SIMD_MIN) {
+				for (; l; --l)
+					++mc[*p], *q++ = *p++; // $mc: marginal counts of all processed symbols
+			} else copy_count(q, p, l, mc), q += l, p += l;
 			*q++ = c;
 			pre = u->u + 1; u->u = mc[c]++;
 			if (c) a[n++] = a[k], ++mc2[c]; // $mc2: marginal counts of the current column
 		}
-		while (p < end) ++mc[*p], *q++ = *p++; // copy the rest of $B0 to $B
+		copy_count(q, p, end - p, mc); // copy the rest of $B0 to $B
 		for (c = 1, ac[0] = 0; c != 256; ++c) ac[c] = ac[c-1] + mc[c-1]; // accumulative count
-		for (k = 0; k < n; ++k) a[k].u += ac[a[k].v&0xff] + n; // compute positions for the next round
 		//printf("===> %ld: '", i); for (k = 0; k < Blen-n0; ++k) putchar(B0[k]); printf("' <===\n"); for (k = 0; k < n0; ++k) printf("%lld\t%lld\n", a[k].v>>8, a[k].u);
-		// stable counting sort ($a[k].v&0xff); also possible with an in-place non-stable radix sort, which is slower
-		aa = malloc(sizeof(pair64_t) * n);
+		// stable counting sort ($a[k].v&0xff); also possible with an in-place non-stable radix sort, which is slower.
+		// The positions for the next round are computed in the same pass, into the buffer of the previous round.
 		for (c = 1, b[0] = aa; c != 256; ++c) b[c] = b[c-1] + mc2[c-1];
-		for (k = 0; k < n; ++k) *b[a[k].v&0xff]++ = a[k]; // this works because $a is already partially sorted
-		free(a); a = aa; // $aa now becomes $a
+		for (k = 0; k < n; ++k) { // this works because $a is already partially sorted
+			pair64_t *u = b[a[k].v&0xff]++;
+			u->u = a[k].u + ac[a[k].v&0xff] + n, u->v = a[k].v;
+		}
+		t = a, a = aa, aa = t; // $aa now becomes $a
 		B0 = B; n0 = n;
 	}
-	free(P); free(a);
+	free(a); free(aa);
 	return B;
 }
 
@@ -5,6 +5,13 @@
 extern "C" {
 #endif
     uint8_t *bcr_lite(long Blen, uint8_t *B, long Tlen, const uint8_t *T);
+
+    /**
+     * Symbol $i of sequence $k counted from its end ($i = 0 is the last
+     * symbol), or 0 if the sequence has at most $i symbols.
+     */
+    typedef uint8_t (*bcr_symbol_f)(void *data, long k, long i);
+    uint8_t *bcr_lite_seq(long Blen, uint8_t *B, long Tlen, long n, bcr_symbol_f symbol, void *data);
 #ifdef __cplusplus
 }
 #endif
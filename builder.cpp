@@ -6,12 +6,14 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <ctime>
 #include <cstring>
 #include <cassert>
 #include <getopt.h>
 #include "bcr-demo.h"
 #include "CGkArray.h"
+#include "PackedText.h"
 
 // Include from library RLCSA
 #include "bits/deltavector.h"
@@ -20,21 +22,125 @@ using namespace std;
 
 #define DEFAULT_SAMPLERATE 16
 #define DEFAULT_BLOCKSIZE 16
+#define DEFAULT_RRR_SAMPLERATE 32
+
+// Long options without a short equivalent
+enum { OPT_SAMPLED = 256, OPT_BLAST, OPT_BLCP, OPT_ISA_SAMPLERATE, OPT_ISA_READ_ANCHORED, OPT_BOTH_STRANDS, OPT_BIDIRECTIONAL, OPT_READ_RANGES };
 
 /**
  * Flags set based on command line parameters
  */
 bool verbose = false;
 unsigned gk = 0; // K for Gk arrays
+vector<unsigned> extraGk; // Additional k-mer lengths sharing the same BWT
 
-void revstr(char *t, ulong n)
+/**
+ * Sequences given to bcr_lite_seq(): the reads of the packed text, followed
+ * by their reverse complements if bothStrands is set, each read reversed
+ * if reverse is set. Reverse complements are not stored but read backwards.
+ *
+ * BCR asks for the symbols of each sequence from its end, one position
+ * per round. The read start positions are cached, and each sequence
+ * keeps a cursor into the exceptions of the text (see PackedText), so
+ * that a symbol costs no select or search.
+ */
+struct BCRInput
 {
-    char c;
-    for (ulong i = 0; i < n / 2; ++i) {
-        c = t[i];
-        t[i] = t[n - i - 1];
-        t[n - i - 1] = c;
+    PackedText const *text;
+    bool bothStrands;
+    bool reverse;
+    vector<ulong> starts;  // Read start positions, followed by the text length
+    vector<ulong> cursors; // Exception cursor of each sequence, if any exceptions
+
+    BCRInput(PackedText const *text_, bool bothStrands_)
+        : text(text_), bothStrands(bothStrands_), reverse(false), starts(), cursors()
+    {
+        ReadBoundary const &rb = text->readBoundaries();
+        starts.reserve(rb.getNumberOfReads() + 1);
+        for (unsigned r = 0; r <= rb.getNumberOfReads(); ++r)
+            starts.push_back(rb.start(r));
+        setReverse(false);
     }
+
+    // Total length of the sequences
+    long length() const
+    {
+        return bothStrands ? 2*text->getLength() : text->getLength();
+    }
+    long numberOfSequences() const
+    {
+        return bothStrands ? 2l*text->getNumberOfReads() : text->getNumberOfReads();
+    }
+
+    // Sets the direction of the reads and rewinds the cursors
+    void setReverse(bool reverse_)
+    {
+        reverse = reverse_;
+        if (text->getNumberOfExceptions() == 0)
+            return;
+        cursors.resize(numberOfSequences());
+        unsigned m = starts.size() - 1;
+        for (ulong k = 0; k < cursors.size(); ++k)
+        {
+            unsigned r = k >= m ? k - m : k;
+            // Cursor is the number of exceptions before the next position,
+            // or before the end if the positions are decreasing
+            cursors[k] = text->exceptionsBefore(decreasing(k) ? starts[r+1] - 1 : starts[r]);
+        }
+    }
+
+    // True if the positions of sequence k are read from the end of the read
+    bool decreasing(ulong k) const
+    {
+        return (k >= starts.size() - 1) == reverse;
+    }
+
+    // Symbol i of sequence k from its end
+    uchar symbol(long k, long i)
+    {
+        unsigned m = starts.size() - 1;
+        bool rc = k >= m;
+        unsigned r = rc ? k - m : k;
+        ulong begin = starts[r];
+        ulong end = starts[r+1] - 1; // Position of the terminator
+        if ((ulong)i >= end - begin)
+            return 0;
+        ulong pos = rc != reverse ? begin + i : end - 1 - i;
+        uchar c = text->base(pos);
+        if (!cursors.empty())
+        {
+            ulong &j = cursors[k];
+            if (decreasing(k))
+            {
+                while (j > 0 && text->exceptionPosition(j-1) > pos)
+                    --j;
+                if (j > 0 && text->exceptionPosition(j-1) == pos)
+                    c = text->exceptionSymbol(j-1);
+            }
+            else
+            {
+                while (j < text->getNumberOfExceptions() && text->exceptionPosition(j) < pos)
+                    ++j;
+                if (j < text->getNumberOfExceptions() && text->exceptionPosition(j) == pos)
+                    c = text->exceptionSymbol(j);
+            }
+        }
+        if (!rc)
+            return c;
+        switch (c)
+        {
+        case 'A': return 'T';
+        case 'T': return 'A';
+        case 'C': return 'G';
+        case 'G': return 'C';
+        default:  return 'N';
+        }
+    }
+};
+
+uint8_t bcr_symbol(void *data, long k, long i)
+{
+    return ((BCRInput *)data)->symbol(k, i);
 }
 
 void write(long length, CSA::DeltaEncoder & de, string const &filename)
@@ -65,10 +171,32 @@ void print_help(char const *name)
          << "The input must be in plain-text format (i.e. sequences separated by '\\n')." << endl
          << "If no output filename is given, the index is stored as <input>.cgka" << endl << endl
          << "Options:" << endl
-         << " -k <int>, --gk <int>          k-mer length (mandatory option)." << endl
+         << " -k <int>, --gk <int>          k-mer length (mandatory option). A comma-separated" << endl
+         << "                               list, e.g. -k 21,31, indexes several k-mer lengths" << endl
+         << "                               over one BWT; the first one is the default." << endl
          << " -s <int>, --sample-rate <int> Sampling rate for the index, a smaller number " << endl
          << "                               yields a bigger index but can decrease search " << endl
          << "                               time (default: " << DEFAULT_SAMPLERATE << ")." << endl
+         << " --isa-sample-rate <int>       Sampling rate for the inverse suffix array, used" << endl
+         << "                               by all queries that start from a text position" << endl
+         << "                               (default: same as --sample-rate)." << endl
+         << " --isa-read-anchored           Anchor the inverse samples to read ends, so that" << endl
+         << "                               position queries near the end of a read take few" << endl
+         << "                               steps (the end of each read is a free sample)." << endl
+         << " --both-strands                Index also the reverse complement of each read," << endl
+         << "                               so that canonical queries take a single search." << endl
+         << " --bidirectional               Build also the reverse BWT, required by" << endl
+         << "                               extendRight() and moveRight()." << endl
+         << " --read-ranges                 Store the read number of each B_last entry, so" << endl
+         << "                               that queries restricted to a range of reads" << endl
+         << "                               take logarithmic time (larger index)." << endl
+         << " --sampled <type>              Bit vector type for the SA samples," << endl
+         << " --blast <type>                for B_last," << endl
+         << " --blcp <type>                 and for B_lcp. Type is one of" << endl
+         << "                               plain   (uncompressed plus rank directory, default)" << endl
+         << "                               rrr     (RRR compressed, good for dense vectors)" << endl
+         << "                               sdarray (Elias-Fano, good for sparse vectors)" << endl
+         << "                               Use -v to see the size/latency of each choice." << endl
          << " -h, --help                    Display command line options." << endl
          << " -v, --verbose                 Print progress information." << endl;
 }
@@ -85,6 +213,24 @@ int atoi_min(char const *value, int min, char const *parameter, char const *name
     return i;
 }
 
+/**
+ * Returns a bit vector builder for the given type name.
+ * Null pointer means default (plain) bit vector.
+ */
+static_bitsequence_builder * bitsequence_builder(char const *value, char const *parameter, char const *name)
+{
+    string type(value);
+    if (type == "plain")
+        return 0;
+    if (type == "rrr")
+        return new static_bitsequence_builder_rrr02(DEFAULT_RRR_SAMPLERATE);
+    if (type == "sdarray")
+        return new static_bitsequence_builder_sdarray();
+    cerr << name << ": argument of " << parameter << " must be one of plain, rrr or sdarray" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+    std::exit(1);
+}
+
 int main(int argc, char **argv) 
 {
     /**
@@ -95,11 +241,25 @@ int main(int argc, char **argv)
         print_usage(argv[0]);
         return 1;        
     }
-    unsigned samplerate = 0;
+    unsigned samplerate = DEFAULT_SAMPLERATE;
+    unsigned isaSamplerate = 0;
+    bool isaReadAnchored = false;
+    bool bothStrands = false;
+    bool bidirectional = false;
+    bool readRanges = false;
+    static_bitsequence_builder *bsbSampled = 0, *bsbBlast = 0, *bsbBlcp = 0;
     static struct option long_options[] =
         {
             {"gk",          required_argument, 0, 'k'},
             {"sample-rate", required_argument, 0, 's'},
+            {"sampled",     required_argument, 0, OPT_SAMPLED},
+            {"blast",       required_argument, 0, OPT_BLAST},
+            {"blcp",        required_argument, 0, OPT_BLCP},
+            {"isa-sample-rate",   required_argument, 0, OPT_ISA_SAMPLERATE},
+            {"isa-read-anchored", no_argument,       0, OPT_ISA_READ_ANCHORED},
+            {"both-strands",      no_argument,       0, OPT_BOTH_STRANDS},
+            {"bidirectional",     no_argument,       0, OPT_BIDIRECTIONAL},
+            {"read-ranges",       no_argument,       0, OPT_READ_RANGES},
             {"help",        no_argument,       0, 'h'},
             {"verbose",     no_argument,       0, 'v'},
             {0, 0, 0, 0}
@@ -112,11 +272,37 @@ int main(int argc, char **argv)
         switch(c) 
         {
         case 'k':
-            gk = atoi_min(optarg, 3, "-k", argv[0]); 
+        {
+            char *value = strtok(optarg, ",");
+            gk = atoi_min(value, 3, "-k", argv[0]);
+            extraGk.clear();
+            while ((value = strtok(0, ",")) != 0)
+                extraGk.push_back(atoi_min(value, 3, "-k", argv[0]));
             break;
+        }
         case 's':
             samplerate = atoi_min(optarg, 1, "-s, --sample-rate", argv[0]); 
             break;
+        case OPT_SAMPLED:
+            bsbSampled = bitsequence_builder(optarg, "--sampled", argv[0]);
+            break;
+        case OPT_BLAST:
+            bsbBlast = bitsequence_builder(optarg, "--blast", argv[0]);
+            break;
+        case OPT_BLCP:
+            bsbBlcp = bitsequence_builder(optarg, "--blcp", argv[0]);
+            break;
+        case OPT_ISA_SAMPLERATE:
+            isaSamplerate = atoi_min(optarg, 1, "--isa-sample-rate", argv[0]); 
+            break;
+        case OPT_ISA_READ_ANCHORED:
+            isaReadAnchored = true; break;
+        case OPT_BOTH_STRANDS:
+            bothStrands = true; break;
+        case OPT_BIDIRECTIONAL:
+            bidirectional = true; break;
+        case OPT_READ_RANGES:
+            readRanges = true; break;
         case 'h':
             print_help(argv[0]);
             return 0;
@@ -174,14 +360,15 @@ int main(int argc, char **argv)
     time_t wctime = time(NULL);
 
     // estimate the total input sequence length
-    fp->seekg(0, ios::end);
-    long length = fp->tellg();
-    if (length == -1)
+    long sizeHint = 0;
+    if (inputfile != "-")
     {
-        cerr << "error: unable to estimate input file size" << endl;
-        return 1;
+        fp->seekg(0, ios::end);
+        sizeHint = fp->tellg();
+        fp->seekg(0);
+        if (sizeHint < 0)
+            sizeHint = 0;
     }
-    fp->seekg(0);
     
     /**
      * Build forward/rotation index
@@ -189,36 +376,50 @@ int main(int argc, char **argv)
     if (verbose)
         cerr << "Building the forward index:" << endl;
 
-    unsigned numberOfTexts = 0, maxTextLength = 0, curLength = 0;
-    uchar *s = new uchar[length];
-    CSA::DeltaEncoder * de = new CSA::DeltaEncoder(DEFAULT_BLOCKSIZE); // Collects text start positions
-    de->setBit(0);
-    fp->read((char *)s, length);
-    delete fp;
-    for (long i = 0; i < length; ++i)
-        if (s[i] == '\n') 
-        {            
-            s[i] = 0;
-            if (maxTextLength < curLength)
-                maxTextLength = curLength;            
-            curLength = 0;
-            de->setBit(i+1);
-            ++numberOfTexts;
-        }
-        else
-            ++curLength;
-    
-    write(length, *de, outputfile + ".cgka_map");
-    delete de; de = 0;
+    // The input is kept two bits per base, see PackedText
+    PackedText *text = new PackedText(*fp, sizeHint);
+    if (fp != &std::cin)
+        delete fp;
+    if (verbose)
+        cerr << "Packed text: " << text->getNumberOfReads() << " reads, " << text->getLength() << " symbols, "
+             << text->getNumberOfExceptions() << " non-ACGT, " << text->size()/1024 << " kB" << endl;
+
+    BCRInput input(text, bothStrands);
+    long length = input.length();
+    unsigned numberOfTexts = input.numberOfSequences();
+    unsigned maxTextLength = text->getMaxReadLength();
+    {
+        // Text start positions, the reverse complements follow the reads
+        CSA::DeltaEncoder *de = new CSA::DeltaEncoder(DEFAULT_BLOCKSIZE);
+        for (ulong offset = 0; offset < (ulong)length; offset += text->getLength())
+            for (unsigned r = 0; r + 1 < input.starts.size(); ++r)
+                de->setBit(offset + input.starts[r]);
+        de->setBit(length);
+        write(length, *de, outputfile + ".cgka_map");
+        delete de; de = 0;
+    }
 
-    uchar *B = bcr_lite(0, 0, length, s);
-    delete [] s;
+    uchar *B = bcr_lite_seq(0, 0, length, numberOfTexts, bcr_symbol, &input);
+    uchar *Brev = 0;
+    if (bidirectional)
+    {
+        if (verbose)
+            cerr << "Building the reverse BWT" << endl;
+        // Reverse each read but keep the order of reads
+        input.setReverse(true);
+        Brev = bcr_lite_seq(0, 0, length, numberOfTexts, bcr_symbol, &input);
+    }
+    delete text;
 /*    for (long i = 0; i < length; ++i)
         putchar(B[i]? B[i] : '$');
         putchar('\n');*/
 
-    CGkArray *cgka = new CGkArray(B, length, samplerate, numberOfTexts, maxTextLength, gk, verbose);
+    CGkArray *cgka = new CGkArray(B, length, samplerate, numberOfTexts, maxTextLength, gk, verbose,
+                                  bsbSampled, bsbBlast, bsbBlcp, isaSamplerate, isaReadAnchored, bothStrands, Brev, extraGk, readRanges);
     // B was already free()'d;
+    delete bsbSampled;
+    delete bsbBlast;
+    delete bsbBlcp;
 
     cgka->save(outputfile);
 
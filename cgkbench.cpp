@@ -0,0 +1,399 @@
+/**
+ * Query benchmark with latency histograms
+ *
+ * Runs a mix of queries against an index: Q1-Q4 by text position and
+ * by k-mer, and read-coverage profiles. Each query type first runs a
+ * warm-up phase and then a measurement phase, where every query is timed
+ * with a monotonic nanosecond clock. Reports throughput and latency
+ * percentiles per query type as tab-separated values. If compiled with
+ * -DPERF_COUNTERS, the hardware counters of the measurement phase are
+ * reported per query as well, and with -DQUERY_STATS the operation
+ * counts of the index (see CGkArray::getQueryStats()).
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "CGkArray.h"
+#include "ToolCommon.h"
+#include "PerfCounters.h"
+
+using namespace std;
+
+#define DEFAULT_NQUERIES 10000
+#define DEFAULT_NWARMUP 1000
+#define DEFAULT_SEED 543262346
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl << endl
+         << "Benchmarks the queries of <index>." << endl
+         << "If no output filename is given, the results are written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -q <list>, --queries <list>   Comma-separated query types (default: all):" << endl
+         << "                               pos_q1, pos_q2, pos_q3, pos_q4     by text position" << endl
+         << "                               kmer_q1, kmer_q2, kmer_q3, kmer_q4 by k-mer" << endl
+         << "                               coverage                           read-coverage profile" << endl
+         << " -n <int>, --nqueries <int>    Measured queries per type (default: " << DEFAULT_NQUERIES << ")." << endl
+         << " -w <int>, --warmup <int>      Warm-up queries per type (default: " << DEFAULT_NWARMUP << ")." << endl
+         << " -H <float>, --hit-ratio <float>" << endl
+         << "                               Fraction of k-mer queries that occur in the index (default: 1)." << endl
+         << " -K <type>, --kmers <type>     Source of the occurring k-mers and positions:" << endl
+         << "                               random     (uniform over the text positions, default)" << endl
+         << "                               unique     (k-mers that occur once)" << endl
+         << "                               repetitive (the 1000 most frequent k-mers)" << endl
+         << " -s <int>, --seed <int>        Random seed (default: " << DEFAULT_SEED << ")." << endl
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "Output has one line per query type: query type, number of queries," << endl
+         << "throughput (queries per second), and mean, p50, p90, p99 and max latency" << endl
+         << "in nanoseconds. If compiled with hardware counter support, the output" << endl
+         << "also has cycles, instructions, LLC misses and dTLB misses per query" << endl
+         << "(NA if the counter is not available). If compiled with -DQUERY_STATS," << endl
+         << "the output also has the LF steps, HuffWT rank, access and select calls," << endl
+         << "bit vector prev/next calls and located suffixes per query, and the mean" << endl
+         << "and max walk length to a sampled suffix." << endl;
+}
+
+enum query_type { POS_Q1, POS_Q2, POS_Q3, POS_Q4, KMER_Q1, KMER_Q2, KMER_Q3, KMER_Q4, COVERAGE, NQUERYTYPES };
+static char const *QUERY_NAMES[] = { "pos_q1", "pos_q2", "pos_q3", "pos_q4",
+                                     "kmer_q1", "kmer_q2", "kmer_q3", "kmer_q4", "coverage" };
+enum kmer_source { SOURCE_RANDOM, SOURCE_UNIQUE, SOURCE_REPETITIVE };
+
+/**
+ * Query inputs of one phase
+ *
+ * Inputs are generated before the phase so that only the queries are timed.
+ */
+class QueryInputs
+{
+public:
+    QueryInputs(CGkArray const *tc_, kmer_source source_, double hitRatio_)
+        : fallbacks(0), tc(tc_), source(source_), hitRatio(hitRatio_), k(tc_->getGkSize()), frequent()
+    {
+        if (source == SOURCE_REPETITIVE)
+        {
+            CGkArray::kmer_class_vector top = tc->topKmers(1000, CGkArray::by_occs);
+            for (CGkArray::kmer_class_vector::const_iterator it = top.begin(); it != top.end(); ++it)
+                frequent.push_back(it->first);
+        }
+    }
+
+    void generate(query_type type, unsigned n)
+    {
+        positions.clear();
+        kmers.clear();
+        reads.clear();
+        fallbacks = 0;
+        for (unsigned i = 0; i < n; ++i)
+            switch (type)
+            {
+            case POS_Q1: case POS_Q2: case POS_Q3: case POS_Q4:
+                positions.push_back(randomPosition());
+                break;
+            case KMER_Q1: case KMER_Q2: case KMER_Q3: case KMER_Q4:
+                kmers.push_back((double)rand() / RAND_MAX < hitRatio ? occurringKmer() : missingKmer());
+                break;
+            default:
+                reads.push_back(rand() % tc->getNumberOfReads());
+            }
+    }
+
+    vector<ulong> positions;
+    vector<string> kmers;
+    vector<unsigned> reads;
+    // Number of inputs that do not match the k-mer source or the hit ratio,
+    // i.e. non-unique k-mers for "unique" or occurring k-mers given as missing
+    unsigned fallbacks;
+
+private:
+    // Valid text position of the chosen k-mer source
+    ulong randomPosition()
+    {
+        if (source == SOURCE_REPETITIVE && !frequent.empty())
+        {
+            CGkArray::sa_range const &r = frequent[rand() % frequent.size()];
+            CGkArray::position_result p = tc->getPosition(r.first + rand() % (r.second - r.first + 1));
+            return tc->readPosToTextPos(p.first, p.second);
+        }
+        for (unsigned attempt = 0; ; ++attempt)
+        {
+            ulong pos = ((ulong)rand() * RAND_MAX + rand()) % tc->getLength();
+            if (!tc->isValidTextPos(pos))
+                continue;
+            if (source != SOURCE_UNIQUE || tc->countOccs(pos) == 1)
+                return pos;
+            if (attempt >= 1000)
+            {
+                ++fallbacks;
+                return pos;
+            }
+        }
+    }
+
+    string occurringKmer()
+    {
+        uchar *kmer = tc->getSuffix(tc->inverseSA(randomPosition()), k);
+        string s((char const *)kmer, k);
+        delete [] kmer;
+        return s;
+    }
+
+    // Random k-mer that does not occur, if one is found
+    string missingKmer()
+    {
+        static const char bases[] = "ACGT";
+        string s(k, 'A');
+        for (unsigned attempt = 0; attempt < 1000; ++attempt)
+        {
+            for (unsigned i = 0; i < k; ++i)
+                s[i] = bases[rand() % 4];
+            CGkArray::sa_range r = tc->kmerToSARange((uchar const *)s.c_str());
+            if (r.first > r.second)
+                return s;
+        }
+        ++fallbacks;
+        return s;
+    }
+
+    CGkArray const *tc;
+    kmer_source source;
+    double hitRatio;
+    unsigned k;
+    vector<CGkArray::sa_range> frequent;
+};
+
+// k-mer query of the given type
+ulong kmerQuery(CGkArray const *tc, string const &kmer, query_type type)
+{
+    CGkArray::sa_range r = tc->kmerToSARange((uchar const *)kmer.c_str());
+    if (r.first > r.second)
+        return 0;
+    switch (type)
+    {
+    case KMER_Q1: return tc->reportReads(r).size();
+    case KMER_Q2: return tc->countReads(r);
+    case KMER_Q3: return tc->reportOccs(r).size();
+    default:      return tc->countOccs(r);
+    }
+}
+
+/**
+ * Run the i'th query of the given type, returns a value that depends on the result
+ */
+ulong runQuery(CGkArray const *tc, QueryInputs const &in, query_type type, unsigned i, vector<unsigned> &profile)
+{
+    switch (type)
+    {
+    case POS_Q1: return tc->reportReads(in.positions[i]).size();
+    case POS_Q2: return tc->countReads(in.positions[i]);
+    case POS_Q3: return tc->reportOccs(in.positions[i]).size();
+    case POS_Q4: return tc->countOccs(in.positions[i]);
+    case COVERAGE:
+        tc->coverage(in.reads[i], profile);
+        return profile.size();
+    default: return kmerQuery(tc, in.kmers[i], type);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    if (argc <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool verbose = false;
+    unsigned nqueries = DEFAULT_NQUERIES;
+    unsigned nwarmup = DEFAULT_NWARMUP;
+    double hitRatio = 1.0;
+    kmer_source source = SOURCE_RANDOM;
+    unsigned seed = DEFAULT_SEED;
+    vector<query_type> types;
+    static struct option long_options[] =
+        {
+            {"queries",   required_argument, 0, 'q'},
+            {"nqueries",  required_argument, 0, 'n'},
+            {"warmup",    required_argument, 0, 'w'},
+            {"hit-ratio", required_argument, 0, 'H'},
+            {"kmers",     required_argument, 0, 'K'},
+            {"seed",      required_argument, 0, 's'},
+            {"help",      no_argument,       0, 'h'},
+            {"verbose",   no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "q:n:w:H:K:s:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 'q':
+            for (char *name = strtok(optarg, ","); name; name = strtok(0, ","))
+            {
+                unsigned t = 0;
+                while (t < NQUERYTYPES && strcmp(name, QUERY_NAMES[t]) != 0)
+                    ++t;
+                if (t == NQUERYTYPES)
+                {
+                    cerr << argv[0] << ": unknown query type " << name << endl;
+                    return 1;
+                }
+                types.push_back((query_type)t);
+            }
+            break;
+        case 'n':
+            nqueries = atoi(optarg);
+            if (nqueries == 0)
+            {
+                cerr << argv[0] << ": argument of -n,--nqueries must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 'w':
+            nwarmup = atoi(optarg); break;
+        case 'H':
+            hitRatio = atof(optarg); break;
+        case 'K':
+            if (string(optarg) == "random")
+                source = SOURCE_RANDOM;
+            else if (string(optarg) == "unique")
+                source = SOURCE_UNIQUE;
+            else if (string(optarg) == "repetitive")
+                source = SOURCE_REPETITIVE;
+            else
+            {
+                cerr << argv[0] << ": unknown k-mer source " << optarg << endl;
+                return 1;
+            }
+            break;
+        case 's':
+            seed = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+    if (types.empty())
+        for (unsigned t = 0; t < NQUERYTYPES; ++t)
+            types.push_back((query_type)t);
+
+    // Parse filenames
+    if (argc - optind < 1 || argc - optind > 2)
+    {
+        cerr << argv[0] << ": index filename is required" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexfile = string(argv[optind++]);
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    if (verbose) cerr << "Loading index " << indexfile << endl;
+    CGkArray *tc = new CGkArray(indexfile);
+
+    srand(seed);
+    QueryInputs inputs(tc, source, hitRatio);
+    vector<unsigned> profile;
+    vector<ulong> latency(nqueries);
+    volatile ulong checksum = 0; // Keeps the compiler from dropping the queries
+    PerfCounters counters;
+    if (PerfCounters::compiledIn() && !counters.anyAvailable())
+        cerr << argv[0] << ": warning: hardware counters are not available" << endl;
+    fprintf(output, "#query\tn\tqps\tmean_ns\tp50_ns\tp90_ns\tp99_ns\tmax_ns");
+    if (counters.anyAvailable())
+        for (unsigned e = 0; e < PerfCounters::NEVENTS; ++e)
+            fprintf(output, "\t%s", PerfCounters::NAMES[e]);
+    if (CGkArray::queryStatsEnabled())
+        fprintf(output, "\tlf_steps\trank\taccess\tselect\tprev_next\tlocates\tmean_walk\tmax_walk");
+    fprintf(output, "\n");
+    for (vector<query_type>::const_iterator t = types.begin(); t != types.end(); ++t)
+    {
+        if (verbose) cerr << "Running " << QUERY_NAMES[*t] << endl;
+        inputs.generate(*t, nwarmup);
+        for (unsigned i = 0; i < nwarmup; ++i)
+            checksum += runQuery(tc, inputs, *t, i, profile);
+
+        inputs.generate(*t, nqueries);
+        if (inputs.fallbacks)
+            cerr << argv[0] << ": warning: " << inputs.fallbacks << " of " << nqueries << " " << QUERY_NAMES[*t]
+                 << " inputs do not match the k-mer source or the hit ratio" << endl;
+        // Counters cover the whole phase, including the clock reads
+        CGkArray::resetQueryStats();
+        counters.reset();
+        counters.start();
+        std::chrono::steady_clock::time_point phase = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < nqueries; ++i)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            checksum += runQuery(tc, inputs, *t, i, profile);
+            std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+            latency[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - phase).count();
+        counters.stop();
+
+        double mean = 0;
+        for (unsigned i = 0; i < nqueries; ++i)
+            mean += latency[i];
+        mean /= nqueries;
+        std::sort(latency.begin(), latency.end());
+        fprintf(output, "%s\t%u\t%.1f\t%.1f\t%lu\t%lu\t%lu\t%lu", QUERY_NAMES[*t], nqueries, nqueries / seconds, mean,
+                latency[nqueries / 2], latency[(ulong)nqueries * 90 / 100], latency[(ulong)nqueries * 99 / 100],
+                latency[nqueries - 1]);
+        if (counters.anyAvailable())
+            for (unsigned e = 0; e < PerfCounters::NEVENTS; ++e)
+            {
+                PerfCounters::event ev = (PerfCounters::event)e;
+                if (counters.available(ev))
+                    fprintf(output, "\t%.1f", (double)counters.value(ev) / nqueries);
+                else
+                    fprintf(output, "\tNA");
+            }
+        if (CGkArray::queryStatsEnabled())
+        {
+            CGkArray::query_stats qs = CGkArray::getQueryStats();
+            fprintf(output, "\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%lu", (double)qs.lfSteps / nqueries,
+                    (double)qs.rankCalls / nqueries, (double)qs.accessCalls / nqueries, (double)qs.selectCalls / nqueries,
+                    (double)qs.bitvectorCalls / nqueries, (double)qs.locates / nqueries,
+                    qs.locates ? (double)qs.locateSteps / qs.locates : 0.0, qs.maxLocateSteps);
+        }
+        fprintf(output, "\n");
+        fflush(output);
+    }
+
+    if (verbose)
+        cerr << "Checksum " << checksum << endl;
+    delete tc;
+    if (!ToolCommon::CloseOutput(output))
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        return 1;
+    }
+    return 0;
+}
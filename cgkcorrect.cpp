@@ -0,0 +1,374 @@
+/**
+ * k-mer based read error correction
+ *
+ * A k-mer is solid if it occurs in at least s reads, otherwise weak.
+ * For each run of weak k-mers along a read, the substitutions that
+ * turn the first k-mer of the run into a solid k-mer are found by
+ * one-mismatch search (see kmerToSARanges()). A substitution is applied
+ * if it makes all k-mers covering the substituted position solid, and
+ * no other candidate does so with the same support. The reads are
+ * processed in chunks that are distributed across threads; corrected
+ * reads are written in read order, one read per line.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "CGkArray.h"
+#include "ToolCommon.h"
+
+using namespace std;
+
+#define DEFAULT_SOLID 3
+#define DEFAULT_MAX_CORRECTIONS 4
+#define DEFAULT_CHUNKSIZE 1024
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl << endl
+         << "Corrects substitution errors of the reads in <index>." << endl
+         << "If no output filename is given, the reads are written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -s <int>, --solid <int>       k-mers occurring in at least this many reads are" << endl
+         << "                               solid (default: " << DEFAULT_SOLID << ")." << endl
+         << " -m <int>, --max-corrections <int>" << endl
+         << "                               Maximum number of substitutions per read (default: " << DEFAULT_MAX_CORRECTIONS << ")." << endl
+         << " -k <int>, --gk <int>          k-mer length, for indexes with several k (default: first)." << endl
+         << " -c <int>, --chunk-size <int>  Number of reads per work unit (default: " << DEFAULT_CHUNKSIZE << ")." << endl
+#ifdef PARALLEL_SUPPORT
+         << " -t <int>, --threads <int>     Number of threads, 0 uses all cores (default: 0)." << endl
+#endif
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "The output has one corrected read per line, in the input order." << endl
+         << "If the index contains both strands, only the input reads are written." << endl;
+}
+
+/**
+ * Corrector of one read at a time
+ *
+ * Each thread has its own instance, the index is shared.
+ */
+class ReadCorrector
+{
+public:
+    ReadCorrector(CGkArray const *tc_, unsigned k_, unsigned solid_, unsigned maxCorrections_)
+        : tc(tc_), k(k_), solid(solid_), maxCorrections(maxCorrections_)
+    { }
+
+    // Corrects the given '\0'-terminated read in place, returns the number of substitutions
+    unsigned correct(uchar *read)
+    {
+        ulong l = strlen((char const *)read);
+        if (l < k)
+            return 0;
+        unsigned corrections = 0;
+        vector<bool> unfixable(l - k + 1, false);
+        while (corrections < maxCorrections)
+        {
+            profile(read, l);
+            weakRuns(l);
+            if (runs.empty())
+                break;
+
+            // First k-mer of each run and its solid one-mismatch neighbours
+            kmers.clear();
+            for (vector<run>::const_iterator it = runs.begin(); it != runs.end(); ++it)
+                kmers.push_back(read + it->first);
+            tc->kmerToSARanges(kmers, 1, neighbours, k);
+
+            bool changed = false;
+            for (unsigned r = 0; r < runs.size() && corrections < maxCorrections; ++r)
+            {
+                ulong a = runs[r].first;
+                if (unfixable[a])
+                    continue;
+                ulong pos = 0;
+                uchar base = 0;
+                if (bestSubstitution(read, l, a, neighbours[r], pos, base))
+                {
+                    read[pos] = base;
+                    ++corrections;
+                    changed = true;
+                }
+                else
+                    unfixable[a] = true;
+            }
+            if (!changed)
+                break;
+        }
+        return corrections;
+    }
+
+private:
+    typedef pair<ulong, ulong> run; // First and last k-mer position
+
+    // Number of reads of each k-mer of the read
+    void profile(uchar const *read, ulong l)
+    {
+        cov.assign(l - k + 1, 0);
+        CGkArray::internal_pointer ip = tc->initMoveLeft(read, k);
+        for (ulong j = l - k + 1; j > 0; --j)
+        {
+            CGkArray::sa_range sar = tc->moveLeft(ip, read, k); // k-mer at position j-1
+            if (sar.first <= sar.second)
+                cov[j-1] = tc->countReads(sar, k);
+        }
+    }
+
+    // Maximal runs of weak k-mers
+    void weakRuns(ulong l)
+    {
+        runs.clear();
+        for (ulong i = 0; i <= l - k; ++i)
+        {
+            if (cov[i] >= solid)
+                continue;
+            ulong j = i;
+            while (j < l - k && cov[j+1] < solid)
+                ++j;
+            runs.push_back(make_pair(i, j));
+            i = j;
+        }
+    }
+
+    /**
+     * Find the substitution in the k-mer at position a that makes
+     * all covering k-mers solid. Candidates are verified with one
+     * batch of exact lookups, ties on the support are rejected.
+     */
+    bool bestSubstitution(uchar *read, ulong l, ulong a, CGkArray::approximate_vector const &cands,
+                          ulong &pos, uchar &base)
+    {
+        candidates.clear();
+        verify.clear();
+        for (CGkArray::approximate_vector::const_iterator it = cands.begin(); it != cands.end(); ++it)
+        {
+            if (it->second.size() != 1 || tc->countReads(it->first, k) < solid)
+                continue;
+            ulong p = a + it->second[0];
+            uchar *kmer = tc->getSuffix(it->first.first, k);
+            uchar c = kmer[it->second[0]];
+            delete [] kmer;
+            // Covering k-mers with the substitution applied
+            ulong first = p >= k - 1 ? p - (k - 1) : 0;
+            ulong last = p < l - k ? p : l - k;
+            string s((char const *)read + first, last + k - first);
+            s[p - first] = c;
+            candidates.push_back(make_pair(make_pair(p, c), make_pair(verify.size(), last - first + 1)));
+            verify.push_back(s);
+        }
+        if (candidates.empty())
+            return false;
+
+        kmers.clear();
+        for (unsigned i = 0; i < verify.size(); ++i)
+            for (ulong j = 0; j + k <= verify[i].size(); ++j)
+                kmers.push_back((uchar const *)verify[i].c_str() + j);
+        tc->kmerToSARanges(kmers, 0, exact, k);
+
+        // Support of a candidate is the minimum number of reads over its covering k-mers
+        unsigned best = 0, bestCount = 0;
+        ulong e = 0;
+        for (vector<candidate>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+        {
+            unsigned support = ~0u;
+            for (ulong j = 0; j < it->second.second; ++j, ++e)
+            {
+                unsigned c = exact[e].empty() ? 0 : tc->countReads(exact[e][0].first, k);
+                support = std::min(support, c);
+            }
+            if (support < solid)
+                continue;
+            if (support > best)
+            {
+                best = support;
+                bestCount = 0;
+                pos = it->first.first;
+                base = it->first.second;
+            }
+            if (support == best)
+                ++bestCount;
+        }
+        return bestCount == 1;
+    }
+
+    // Substitution (position, base) and its k-mers in verify (index, count)
+    typedef pair<pair<ulong, uchar>, pair<unsigned, ulong> > candidate;
+
+    CGkArray const *tc;
+    unsigned k;
+    unsigned solid;
+    unsigned maxCorrections;
+    vector<unsigned> cov;
+    vector<run> runs;
+    vector<uchar const *> kmers;
+    vector<CGkArray::approximate_vector> neighbours;
+    vector<CGkArray::approximate_vector> exact;
+    vector<candidate> candidates;
+    vector<string> verify;
+};
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    if (argc <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool verbose = false;
+    unsigned solid = DEFAULT_SOLID;
+    unsigned maxCorrections = DEFAULT_MAX_CORRECTIONS;
+    unsigned k = 0;
+    unsigned chunksize = DEFAULT_CHUNKSIZE;
+    unsigned parallel = 0;
+    static struct option long_options[] =
+        {
+            {"solid",           required_argument, 0, 's'},
+            {"max-corrections", required_argument, 0, 'm'},
+            {"gk",              required_argument, 0, 'k'},
+            {"chunk-size",      required_argument, 0, 'c'},
+            {"threads",         required_argument, 0, 't'},
+            {"help",            no_argument,       0, 'h'},
+            {"verbose",         no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "s:m:k:c:t:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 's':
+            solid = atoi(optarg);
+            if (solid == 0)
+            {
+                cerr << argv[0] << ": argument of -s,--solid must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 'm':
+            maxCorrections = atoi(optarg); break;
+        case 'k':
+            k = atoi(optarg); break;
+        case 'c':
+            chunksize = atoi(optarg);
+            if (chunksize == 0)
+            {
+                cerr << argv[0] << ": argument of -c,--chunk-size must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 't':
+            parallel = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+
+    // Parse filenames
+    if (argc - optind < 1 || argc - optind > 2)
+    {
+        cerr << argv[0] << ": index filename is required" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexfile = string(argv[optind++]);
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    if (verbose) cerr << "Loading index " << indexfile << endl;
+    CGkArray *tc = new CGkArray(indexfile);
+    if (k == 0)
+        k = tc->getGkSize();
+    vector<unsigned> ks = tc->getGkSizes();
+    if (std::find(ks.begin(), ks.end(), k) == ks.end())
+    {
+        cerr << argv[0] << ": k-mer length " << k << " was not indexed" << endl;
+        delete tc;
+        return 1;
+    }
+
+    ToolCommon::SetThreads(argv[0], parallel, verbose);
+
+    time_t wctime = time(NULL);
+    unsigned nreads = tc->getNumberOfReads();
+    if (tc->hasBothStrands())
+        nreads /= 2; // Skip the reverse complemented reads
+    long nchunks = (nreads + chunksize - 1) / chunksize;
+    ulong ncorrections = 0, ncorrected = 0;
+    bool failed = false;
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel reduction(+:ncorrections,ncorrected)
+#endif
+    {
+        ReadCorrector corrector(tc, k, solid, maxCorrections);
+        vector<char> buffer;
+#ifdef PARALLEL_SUPPORT
+#pragma omp for ordered schedule(dynamic, 1)
+#endif
+        for (long chunk = 0; chunk < nchunks; ++chunk)
+        {
+            unsigned first = chunk * chunksize;
+            unsigned last = first + chunksize < nreads ? first + chunksize : nreads;
+            for (unsigned readno = first; readno < last; ++readno)
+            {
+                uchar *read = tc->getRead(readno);
+                unsigned x = corrector.correct(read);
+                ncorrections += x;
+                if (x)
+                    ++ncorrected;
+                buffer.insert(buffer.end(), read, read + tc->getLength(readno) - 1);
+                buffer.push_back('\n');
+                delete [] read;
+            }
+#ifdef PARALLEL_SUPPORT
+#pragma omp ordered
+#endif
+            {
+                if (!ToolCommon::WriteBuffer(output, buffer))
+                    failed = true;
+            }
+        }
+    }
+
+    if (!ToolCommon::CloseOutput(output))
+        failed = true;
+    if (failed)
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        delete tc;
+        return 1;
+    }
+    if (verbose)
+        cerr << ncorrections << " substitutions in " << ncorrected << " of " << nreads << " reads. Wall-clock time: "
+             << std::difftime(time(NULL), wctime) << " s." << endl;
+    delete tc;
+    return 0;
+}
@@ -0,0 +1,227 @@
+/**
+ * Read-coverage profiles for all reads in the index
+ *
+ * For each read, reports countReads() of every k-mer of the read,
+ * i.e. in how many reads the k-mer at each position occurs.
+ * Reads are processed in chunks that are distributed across threads;
+ * the output is written in read order.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+
+#include "CGkArray.h"
+#include "ToolCommon.h"
+
+using namespace std;
+
+#define DEFAULT_CHUNKSIZE 1024
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl << endl
+         << "Computes the read-coverage profile of every read in <index>." << endl
+         << "If no output filename is given, the profiles are written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -b, --binary                  Binary output (default: TSV)." << endl
+         << " -C, --canonical               Count the k-mers of both strands (see countReadsCanonical())." << endl
+         << " -c <int>, --chunk-size <int>  Number of reads per work unit (default: " << DEFAULT_CHUNKSIZE << ")." << endl
+#ifdef PARALLEL_SUPPORT
+         << " -t <int>, --threads <int>     Number of threads, 0 uses all cores (default: 0)." << endl
+#endif
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "TSV output has one line per read: the read number followed by the" << endl
+         << "coverage at each read position, separated by tabs." << endl
+         << "Binary output has one record per read: the number of positions" << endl
+         << "followed by the coverage at each position, all as 32-bit unsigned integers." << endl;
+}
+
+/**
+ * Output buffer for one chunk of reads
+ *
+ * Each thread fills its own buffer, and buffers are flushed
+ * to the output file in read order.
+ */
+class OutputBuffer
+{
+public:
+    OutputBuffer(bool binary_)
+        : binary(binary_), data()
+    { }
+
+    void append(unsigned readno, vector<unsigned> const &profile)
+    {
+        if (binary)
+        {
+            uint32_t l = profile.size();
+            put(&l, sizeof(uint32_t));
+            for (vector<unsigned>::const_iterator it = profile.begin(); it != profile.end(); ++it)
+            {
+                uint32_t x = *it;
+                put(&x, sizeof(uint32_t));
+            }
+            return;
+        }
+        char tmp[16];
+        put(tmp, snprintf(tmp, sizeof(tmp), "%u", readno));
+        for (vector<unsigned>::const_iterator it = profile.begin(); it != profile.end(); ++it)
+            put(tmp, snprintf(tmp, sizeof(tmp), "\t%u", *it));
+        data.push_back('\n');
+    }
+
+    // Returns false on write error
+    bool flush(FILE *fp)
+    {
+        return ToolCommon::WriteBuffer(fp, data);
+    }
+
+private:
+    void put(void const *p, size_t l)
+    {
+        char const *c = (char const *)p;
+        data.insert(data.end(), c, c + l);
+    }
+
+    bool binary;
+    vector<char> data;
+};
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    if (argc <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool verbose = false;
+    bool binary = false;
+    bool canonical = false;
+    unsigned chunksize = DEFAULT_CHUNKSIZE;
+    unsigned parallel = 0;
+    static struct option long_options[] =
+        {
+            {"binary",     no_argument,       0, 'b'},
+            {"canonical",  no_argument,       0, 'C'},
+            {"chunk-size", required_argument, 0, 'c'},
+            {"threads",    required_argument, 0, 't'},
+            {"help",       no_argument,       0, 'h'},
+            {"verbose",    no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "bCc:t:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 'b':
+            binary = true; break;
+        case 'C':
+            canonical = true; break;
+        case 'c':
+            chunksize = atoi(optarg);
+            if (chunksize == 0)
+            {
+                cerr << argv[0] << ": argument of -c,--chunk-size must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 't':
+            parallel = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+
+    // Parse filenames
+    if (argc - optind < 1 || argc - optind > 2)
+    {
+        cerr << argv[0] << ": index filename is required" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexfile = string(argv[optind++]);
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    if (verbose) cerr << "Loading index " << indexfile << endl;
+    CGkArray *tc = new CGkArray(indexfile);
+
+    ToolCommon::SetThreads(argv[0], parallel, verbose);
+
+    time_t wctime = time(NULL);
+    unsigned nreads = tc->getNumberOfReads();
+    if (canonical && tc->hasBothStrands())
+        nreads /= 2; // Skip the reverse complemented reads
+    long nchunks = (nreads + chunksize - 1) / chunksize;
+    bool failed = false;
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel
+#endif
+    {
+        vector<unsigned> profile;
+        OutputBuffer buffer(binary);
+#ifdef PARALLEL_SUPPORT
+#pragma omp for ordered schedule(dynamic, 1)
+#endif
+        for (long chunk = 0; chunk < nchunks; ++chunk)
+        {
+            unsigned first = chunk * chunksize;
+            unsigned last = first + chunksize < nreads ? first + chunksize : nreads;
+            for (unsigned readno = first; readno < last; ++readno)
+            {
+                if (canonical)
+                    tc->coverageCanonical(readno, profile);
+                else
+                    tc->coverage(readno, profile);
+                buffer.append(readno, profile);
+            }
+#ifdef PARALLEL_SUPPORT
+#pragma omp ordered
+#endif
+            {
+                if (!buffer.flush(output))
+                    failed = true;
+            }
+        }
+    }
+
+    if (!ToolCommon::CloseOutput(output))
+        failed = true;
+    if (failed)
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        delete tc;
+        return 1;
+    }
+    if (verbose)
+        cerr << "Coverage of " << nreads << " reads done. Wall-clock time: "
+             << std::difftime(time(NULL), wctime) << " s." << endl;
+    delete tc;
+    return 0;
+}
@@ -0,0 +1,278 @@
+/**
+ * Differential k-mer comparison between two indexes
+ *
+ * Reports the k-mers whose counts in the two indexes differ by at least
+ * a threshold. Both indexes are traversed in lockstep by backward search:
+ * each node of the traversal is a pattern P with its suffix array range
+ * in both indexes, and its children are the patterns cP. A subtree is
+ * pruned as soon as P occurs fewer times than the threshold in both
+ * indexes, so the k-mers are never decoded or hashed. The subtrees of
+ * the two-symbol suffixes are distributed across threads.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+
+#include "CGkArray.h"
+#include "ToolCommon.h"
+
+using namespace std;
+
+#define DEFAULT_MIN_DIFFERENCE 10
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index A> <index B> [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index A> <index B> [output]" << endl << endl
+         << "Reports the k-mers whose counts in <index A> and <index B> differ." << endl
+         << "If no output filename is given, the k-mers are written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -d <int>, --min-difference <int>" << endl
+         << "                               Minimum absolute difference of the counts (default: " << DEFAULT_MIN_DIFFERENCE << ")." << endl
+         << " -f <float>, --min-fold <float>" << endl
+         << "                               Minimum fold change (max+1)/(min+1) of the counts (default: none)." << endl
+         << " -r, --reads                   Count reads instead of occurrences." << endl
+         << " -k <int>, --gk <int>          k-mer length (default: first of A). With -r the length" << endl
+         << "                               must be indexed in both." << endl
+#ifdef PARALLEL_SUPPORT
+         << " -t <int>, --threads <int>     Number of threads, 0 uses all cores (default: 0)." << endl
+#endif
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "Each output line has a k-mer, its count in A and its count in B, separated" << endl
+         << "by tabs. The k-mers are sorted by their reverse, i.e. by the last symbol first." << endl;
+}
+
+// Symbols of the k-mers, assuming DNA alphabet
+static const uchar ALPHABET[] = {'A', 'C', 'G', 'N', 'T'};
+static const unsigned SIGMA = sizeof(ALPHABET);
+
+/**
+ * Lockstep traversal of two indexes
+ */
+class KmerDiff
+{
+public:
+    KmerDiff(CGkArray const *a_, CGkArray const *b_, unsigned k_, unsigned minDiff_, double minFold_, bool byReads_)
+        : buffer(), nkmers(0), nnodes(0), a(a_), b(b_), k(k_), minDiff(minDiff_), minFold(minFold_), 
+          byReads(byReads_), pattern(k_ + 1, '\0')
+    { }
+
+    // Traverse the k-mers that end with the given suffix
+    void traverse(uchar const *suffix, unsigned l)
+    {
+        CGkArray::sa_range ra = make_pair(0, a->getLength()-1);
+        CGkArray::sa_range rb = make_pair(0, b->getLength()-1);
+        for (unsigned i = l; i > 0; --i)
+        {
+            pattern[k-l+i-1] = suffix[i-1];
+            ra = a->extendLeft(ra, suffix[i-1]);
+            rb = b->extendLeft(rb, suffix[i-1]);
+        }
+        visit(ra, rb, k-l);
+    }
+
+    // Output of the current task, number of reported k-mers and visited nodes
+    vector<char> buffer;
+    ulong nkmers;
+    ulong nnodes;
+
+private:
+    // Node of pattern[i..k-1]
+    void visit(CGkArray::sa_range const &ra, CGkArray::sa_range const &rb, unsigned i)
+    {
+        ++nnodes;
+        ulong occa = ra.first <= ra.second ? ra.second - ra.first + 1 : 0;
+        ulong occb = rb.first <= rb.second ? rb.second - rb.first + 1 : 0;
+        // Counts of the k-mers below are bounded by the occurrences of the pattern
+        if (occa < minDiff && occb < minDiff)
+            return;
+        if (i > 0)
+        {
+            for (unsigned c = 0; c < SIGMA; ++c)
+            {
+                pattern[i-1] = ALPHABET[c];
+                visit(a->extendLeft(ra, ALPHABET[c]), b->extendLeft(rb, ALPHABET[c]), i-1);
+            }
+            return;
+        }
+
+        ulong ca = occa, cb = occb;
+        if (byReads)
+        {
+            ca = occa ? a->countReads(ra, k) : 0;
+            cb = occb ? b->countReads(rb, k) : 0;
+        }
+        ulong hi = std::max(ca, cb), lo = std::min(ca, cb);
+        if (hi - lo < minDiff || (minFold > 0 && (hi + 1.0) / (lo + 1.0) < minFold))
+            return;
+        char tmp[64];
+        buffer.insert(buffer.end(), pattern.begin(), pattern.begin() + k);
+        int l = snprintf(tmp, sizeof(tmp), "\t%lu\t%lu\n", ca, cb);
+        buffer.insert(buffer.end(), tmp, tmp + l);
+        ++nkmers;
+    }
+
+    CGkArray const *a;
+    CGkArray const *b;
+    unsigned k;
+    ulong minDiff;
+    double minFold;
+    bool byReads;
+    string pattern;
+};
+
+bool isIndexed(CGkArray const *tc, unsigned k)
+{
+    vector<unsigned> ks = tc->getGkSizes();
+    return std::find(ks.begin(), ks.end(), k) != ks.end();
+}
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    if (argc <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool verbose = false;
+    bool byReads = false;
+    unsigned minDiff = DEFAULT_MIN_DIFFERENCE;
+    double minFold = 0;
+    unsigned k = 0;
+    unsigned parallel = 0;
+    static struct option long_options[] =
+        {
+            {"min-difference", required_argument, 0, 'd'},
+            {"min-fold",       required_argument, 0, 'f'},
+            {"reads",          no_argument,       0, 'r'},
+            {"gk",             required_argument, 0, 'k'},
+            {"threads",        required_argument, 0, 't'},
+            {"help",           no_argument,       0, 'h'},
+            {"verbose",        no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "d:f:rk:t:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 'd':
+            minDiff = atoi(optarg);
+            if (minDiff == 0)
+            {
+                cerr << argv[0] << ": argument of -d,--min-difference must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 'f':
+            minFold = atof(optarg); break;
+        case 'r':
+            byReads = true; break;
+        case 'k':
+            k = atoi(optarg); break;
+        case 't':
+            parallel = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+
+    // Parse filenames
+    if (argc - optind < 2 || argc - optind > 3)
+    {
+        cerr << argv[0] << ": two index filenames are required" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexA = string(argv[optind++]);
+    string indexB = string(argv[optind++]);
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    if (verbose) cerr << "Loading indexes " << indexA << " and " << indexB << endl;
+    CGkArray *a = new CGkArray(indexA);
+    CGkArray *b = new CGkArray(indexB);
+    if (k == 0)
+        k = a->getGkSize();
+    // Occurrence counts need no B_last, any k will do
+    if (byReads && (!isIndexed(a, k) || !isIndexed(b, k)))
+    {
+        cerr << argv[0] << ": k-mer length " << k << " was not indexed in both indexes" << endl;
+        delete a;
+        delete b;
+        return 1;
+    }
+
+    ToolCommon::SetThreads(argv[0], parallel, verbose);
+
+    time_t wctime = time(NULL);
+    long ntasks = SIGMA * SIGMA;
+    ulong nkmers = 0, nnodes = 0;
+    bool failed = false;
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel reduction(+:nkmers,nnodes)
+#endif
+    {
+        KmerDiff diff(a, b, k, minDiff, minFold, byReads);
+#ifdef PARALLEL_SUPPORT
+#pragma omp for ordered schedule(dynamic, 1)
+#endif
+        for (long task = 0; task < ntasks; ++task)
+        {
+            // Task i covers the k-mers ending with the i'th two-symbol suffix, in reverse order
+            uchar suffix[2] = {ALPHABET[task % SIGMA], ALPHABET[task / SIGMA]};
+            diff.traverse(suffix, 2);
+#ifdef PARALLEL_SUPPORT
+#pragma omp ordered
+#endif
+            {
+                if (!ToolCommon::WriteBuffer(output, diff.buffer))
+                    failed = true;
+            }
+        }
+        nkmers += diff.nkmers;
+        nnodes += diff.nnodes;
+    }
+
+    if (!ToolCommon::CloseOutput(output))
+        failed = true;
+    if (failed)
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        delete a;
+        delete b;
+        return 1;
+    }
+    if (verbose)
+        cerr << nkmers << " differential " << k << "-mers, " << nnodes << " nodes visited. Wall-clock time: "
+             << std::difftime(time(NULL), wctime) << " s." << endl;
+    delete a;
+    delete b;
+    return 0;
+}
@@ -0,0 +1,518 @@
+/**
+ * Micro-benchmark of the succinct primitives
+ *
+ * Measures the primitives that dominate the query time of the index:
+ * the libcds bit vector used for B_lcp and B_last, the Huffman-shaped
+ * wavelet tree, the RLCSA delta-coded bit vector and BlockArray. BitRank,
+ * the bit vector of the earlier pointer-based wavelet tree, is kept for
+ * comparison with the blocks of the flat wavelet tree.
+ * Each structure is built over random data of the requested sizes, from
+ * in-cache to beyond the last level cache, and each operation is run over
+ * random, sequential and clustered arguments. The arguments are generated
+ * before the timing so that only the operations are timed. Operations
+ * are independent, so the results measure throughput, not latency.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "BitRank.h"
+#include "CGkArray.h"
+#include "ToolCommon.h"
+
+using namespace std;
+
+#define DEFAULT_NOPS 1000000
+#define DEFAULT_NWARMUP 100000
+#define DEFAULT_SIZES "12,16,20,24,28"
+#define DEFAULT_DENSITY 0.5
+#define DEFAULT_SEED 543262346
+#define DEFAULT_BLOCKSIZE 16     // DeltaEncoder block size, see builder.cpp
+#define DELTA_MEAN_GAP 100       // Mean gap of DeltaVector, i.e. typical read length
+#define BLOCKARRAY_WIDTH 27      // Field width of BlockArray, i.e. positions of a 100 Mbp text
+#define BLOCKARRAY_DECODE 256    // Values per BlockArray decode
+#define CLUSTER_QUERIES 64       // Clustered pattern: queries per cluster
+#define CLUSTER_WIDTH 4096       // Clustered pattern: width of the cluster
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] [output]" << endl << endl
+         << "Benchmarks the succinct data structures used by the index." << endl
+         << "If no output filename is given, the results are written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -S <list>, --structures <list>" << endl
+         << "                               Comma-separated structures (default: all):" << endl
+         << "                               BitRank     rank, select, select0" << endl
+         << "                               brw32       rank1, prev, next (B_lcp and B_last)" << endl
+         << "                               HuffWT      access, rank, select (BWT)" << endl
+         << "                               DeltaVector rank, select (read starts)" << endl
+         << "                               BlockArray  get, decode (sampled suffixes and positions," << endl
+         << "                                           " << BLOCKARRAY_DECODE << " values per decode)" << endl
+         << " -p <list>, --patterns <list>  Comma-separated access patterns (default: all):" << endl
+         << "                               random      uniform arguments" << endl
+         << "                               sequential  consecutive arguments" << endl
+         << "                               clustered   " << CLUSTER_QUERIES << " arguments within a window of "
+         << CLUSTER_WIDTH << " at a time" << endl
+         << " -b <list>, --bytes <list>     Comma-separated sizes of the structures as log2 of" << endl
+         << "                               bytes (default: " << DEFAULT_SIZES << ")." << endl
+         << " -d <float>, --density <float> Density of 1-bits in BitRank and brw32 (default: " << DEFAULT_DENSITY << ")." << endl
+         << " -n <int>, --nops <int>        Measured operations per test (default: " << DEFAULT_NOPS << ")." << endl
+         << " -w <int>, --warmup <int>      Warm-up operations per test (default: " << DEFAULT_NWARMUP << ")." << endl
+         << " -s <int>, --seed <int>        Random seed (default: " << DEFAULT_SEED << ")." << endl
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "Output has one line per test: structure, operation, access pattern, size" << endl
+         << "in bytes, number of elements and nanoseconds per operation." << endl;
+}
+
+enum structure_type { BITRANK, BRW32, HUFFWT, DELTAVECTOR, BLOCKARRAY, NSTRUCTURES };
+static char const *STRUCTURE_NAMES[] = { "BitRank", "brw32", "HuffWT", "DeltaVector", "BlockArray" };
+enum access_pattern { RANDOM, SEQUENTIAL, CLUSTERED, NPATTERNS };
+static char const *PATTERN_NAMES[] = { "random", "sequential", "clustered" };
+
+// Random value from [0, m)
+inline ulong randomValue(ulong m)
+{
+    return ((ulong)rand() * RAND_MAX + rand()) % m;
+}
+
+/**
+ * Generates the arguments x[0..nops-1] from [first, first+m) in the given pattern
+ */
+void generateArguments(vector<ulong> &x, ulong nops, ulong first, ulong m, access_pattern pattern)
+{
+    x.resize(nops);
+    ulong start = randomValue(m);
+    ulong width = std::min((ulong)CLUSTER_WIDTH, m);
+    for (ulong i = 0; i < nops; ++i)
+    {
+        switch (pattern)
+        {
+        case RANDOM:
+            x[i] = randomValue(m); break;
+        case SEQUENTIAL:
+            x[i] = (start + i) % m; break;
+        default:
+            if (i % CLUSTER_QUERIES == 0)
+                start = randomValue(m - width + 1);
+            x[i] = start + randomValue(width);
+        }
+        x[i] += first;
+    }
+}
+
+/**
+ * Structure under benchmark
+ *
+ * Each operation takes its argument from [first(op), first(op)+domain(op)).
+ * run() applies the operation to x[0..nops-1] and returns a value that
+ * depends on the results.
+ */
+class PrimitiveBench
+{
+public:
+    virtual ~PrimitiveBench() { }
+    virtual unsigned operations() const = 0;
+    virtual char const * operationName(unsigned op) const = 0;
+    virtual ulong first(unsigned op) const = 0;
+    virtual ulong domain(unsigned op) const = 0;
+    virtual ulong run(unsigned op, ulong const *x, ulong nops) = 0;
+    // Number of elements
+    virtual ulong length() const = 0;
+};
+
+// Random bit vector of n bits as 64-bit words, with one extra word for BitRank
+ulong * randomBits(ulong n, double density, ulong &ones)
+{
+    ulong *data = new ulong[n/W + 2];
+    for (ulong i = 0; i < n/W + 2; ++i)
+        data[i] = 0;
+    ones = 0;
+    for (ulong i = 0; i < n; ++i)
+        if ((double)rand() / RAND_MAX < density)
+        {
+            data[i/W] |= 1lu << (i%W);
+            ++ones;
+        }
+    return data;
+}
+
+class BitRankBench : public PrimitiveBench
+{
+public:
+    BitRankBench(ulong bytes, double density)
+        : n(bytes * 8), ones(0), br(0)
+    {
+        ulong *data = randomBits(n, density, ones);
+        br = new BitRank(data, n, true);
+    }
+    ~BitRankBench() { delete br; }
+    unsigned operations() const { return 3; }
+    char const * operationName(unsigned op) const { return op == 0 ? "rank" : op == 1 ? "select" : "select0"; }
+    ulong first(unsigned op) const { return op == 0 ? 0 : 1; }
+    ulong domain(unsigned op) const { return op == 0 ? n : op == 1 ? ones : n - ones; }
+    ulong length() const { return n; }
+    ulong run(unsigned op, ulong const *x, ulong nops)
+    {
+        ulong sum = 0;
+        switch (op)
+        {
+        case 0: for (ulong i = 0; i < nops; ++i) sum += br->rank(x[i]); break;
+        case 1: for (ulong i = 0; i < nops; ++i) sum += br->select(x[i]); break;
+        default: for (ulong i = 0; i < nops; ++i) sum += br->select0(x[i]);
+        }
+        return sum;
+    }
+private:
+    ulong n;
+    ulong ones;
+    BitRank *br;
+};
+
+class Brw32Bench : public PrimitiveBench
+{
+public:
+    Brw32Bench(ulong bytes, double density)
+        : n(bytes * 8), bs(0)
+    {
+        ulong ones = 0;
+        ulong *data = randomBits(n, density, ones);
+        // prev() and next() require a 1-bit at both ends, like B_lcp
+        data[0] |= 1lu;
+        data[(n-1)/W] |= 1lu << ((n-1)%W);
+        // Same construction as B_lcp and B_last in CGkArray.cpp
+        static_bitsequence_builder_brw32 builder(16);
+        bs = builder.build((uint *)data, n);
+        delete [] data;
+    }
+    ~Brw32Bench() { delete bs; }
+    unsigned operations() const { return 3; }
+    char const * operationName(unsigned op) const { return op == 0 ? "rank1" : op == 1 ? "prev" : "next"; }
+    ulong first(unsigned) const { return 0; }
+    ulong domain(unsigned) const { return n; }
+    ulong length() const { return n; }
+    ulong run(unsigned op, ulong const *x, ulong nops)
+    {
+        ulong sum = 0;
+        switch (op)
+        {
+        case 0: for (ulong i = 0; i < nops; ++i) sum += bs->rank1(x[i]); break;
+        case 1: for (ulong i = 0; i < nops; ++i) sum += bs->prev(x[i]); break;
+        default: for (ulong i = 0; i < nops; ++i) sum += bs->next(x[i]);
+        }
+        return sum;
+    }
+private:
+    ulong n;
+    static_bitsequence *bs;
+};
+
+class HuffWTBench : public PrimitiveBench
+{
+public:
+    // Two bits per symbol, so four symbols per byte
+    HuffWTBench(ulong bytes)
+        : n(bytes * 4), minCount(~0lu), wt(0)
+    {
+        // DNA reads of the mean length with a few N's
+        uchar *bwt = (uchar *)std::malloc(n); // Freed by makeHuffWT()
+        for (ulong i = 0; i < n; ++i)
+        {
+            ulong r = rand() % 1000;
+            bwt[i] = r < 10 ? '\0' : r < 11 ? 'N' : SYMBOLS[r % 4];
+        }
+        bwt[n-1] = '\0';
+        wt = HuffWT::makeHuffWT(bwt, n);
+        for (unsigned c = 0; c < 4; ++c)
+            minCount = std::min(minCount, wt->rank(SYMBOLS[c], n-1));
+    }
+    ~HuffWTBench() { HuffWT::deleteHuffWT(wt); }
+    unsigned operations() const { return 3; }
+    char const * operationName(unsigned op) const { return op == 0 ? "access" : op == 1 ? "rank" : "select"; }
+    ulong first(unsigned op) const { return op == 2 ? 1 : 0; }
+    ulong domain(unsigned op) const { return op == 2 ? minCount : n; }
+    ulong length() const { return n; }
+    // Symbols of rank and select cycle through ACGT
+    ulong run(unsigned op, ulong const *x, ulong nops)
+    {
+        ulong sum = 0, rank = 0;
+        switch (op)
+        {
+        case 0: for (ulong i = 0; i < nops; ++i) sum += wt->access(x[i], rank) + rank; break;
+        case 1: for (ulong i = 0; i < nops; ++i) sum += wt->rank(SYMBOLS[i & 3], x[i]); break;
+        default: for (ulong i = 0; i < nops; ++i) sum += wt->select(SYMBOLS[i & 3], x[i]);
+        }
+        return sum;
+    }
+private:
+    static const uchar SYMBOLS[4];
+    ulong n;
+    ulong minCount;
+    HuffWT *wt;
+};
+const uchar HuffWTBench::SYMBOLS[4] = {'A', 'C', 'G', 'T'};
+
+class DeltaVectorBench : public PrimitiveBench
+{
+public:
+    // Roughly two bytes per delta-coded gap
+    DeltaVectorBench(ulong bytes)
+        : n(0), items(bytes / 2), dv(0), iter(0)
+    {
+        CSA::DeltaEncoder encoder(DEFAULT_BLOCKSIZE);
+        for (ulong i = 0; i < items; ++i)
+        {
+            encoder.setBit(n);
+            n += 1 + rand() % (2 * DELTA_MEAN_GAP - 1);
+        }
+        dv = new CSA::DeltaVector(encoder, n);
+        iter = new CSA::DeltaVector::Iterator(*dv);
+    }
+    ~DeltaVectorBench() { delete iter; delete dv; }
+    unsigned operations() const { return 2; }
+    char const * operationName(unsigned op) const { return op == 0 ? "rank" : "select"; }
+    ulong first(unsigned) const { return 0; }
+    ulong domain(unsigned op) const { return op == 0 ? n : items; }
+    ulong length() const { return n; }
+    ulong run(unsigned op, ulong const *x, ulong nops)
+    {
+        ulong sum = 0;
+        if (op == 0)
+            for (ulong i = 0; i < nops; ++i) sum += iter->rank(x[i]);
+        else
+            for (ulong i = 0; i < nops; ++i) sum += iter->select(x[i]);
+        return sum;
+    }
+private:
+    ulong n;
+    ulong items;
+    CSA::DeltaVector *dv;
+    CSA::DeltaVector::Iterator *iter;
+};
+
+class BlockArrayBench : public PrimitiveBench
+{
+public:
+    BlockArrayBench(ulong bytes)
+        : n(bytes * 8 / BLOCKARRAY_WIDTH), ba(0)
+    {
+        ba = new BlockArray(n, BLOCKARRAY_WIDTH);
+        for (ulong i = 0; i < n; ++i)
+            (*ba)[i] = randomValue(1lu << BLOCKARRAY_WIDTH);
+    }
+    ~BlockArrayBench() { delete ba; }
+    unsigned operations() const { return 2; }
+    char const * operationName(unsigned op) const { return op == 0 ? "get" : "decode"; }
+    ulong first(unsigned) const { return 0; }
+    ulong domain(unsigned op) const { return op == 0 ? n : n - BLOCKARRAY_DECODE; }
+    ulong length() const { return n; }
+    ulong run(unsigned op, ulong const *x, ulong nops)
+    {
+        ulong sum = 0;
+        if (op == 0)
+            for (ulong i = 0; i < nops; ++i)
+                sum += ba->get(x[i]);
+        else
+            for (ulong i = 0; i < nops; ++i)
+            {
+                ba->decode(x[i], x[i] + BLOCKARRAY_DECODE, buffer);
+                sum += buffer[i % BLOCKARRAY_DECODE];
+            }
+        return sum;
+    }
+private:
+    ulong n;
+    BlockArray *ba;
+    ulong buffer[BLOCKARRAY_DECODE];
+};
+
+PrimitiveBench * makeBench(structure_type type, ulong bytes, double density)
+{
+    switch (type)
+    {
+    case BITRANK:     return new BitRankBench(bytes, density);
+    case BRW32:       return new Brw32Bench(bytes, density);
+    case HUFFWT:      return new HuffWTBench(bytes);
+    case DELTAVECTOR: return new DeltaVectorBench(bytes);
+    default:          return new BlockArrayBench(bytes);
+    }
+}
+
+// Parses a comma-separated list of names, returns false if a name is unknown
+bool parseNames(char *list, char const **names, unsigned nnames, vector<unsigned> &result, char const *prog)
+{
+    for (char *name = strtok(list, ","); name; name = strtok(0, ","))
+    {
+        unsigned t = 0;
+        while (t < nnames && strcmp(name, names[t]) != 0)
+            ++t;
+        if (t == nnames)
+        {
+            cerr << prog << ": unknown name " << name << endl;
+            return false;
+        }
+        result.push_back(t);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    bool verbose = false;
+    ulong nops = DEFAULT_NOPS;
+    ulong nwarmup = DEFAULT_NWARMUP;
+    double density = DEFAULT_DENSITY;
+    unsigned seed = DEFAULT_SEED;
+    vector<unsigned> structures;
+    vector<unsigned> patterns;
+    vector<unsigned> sizes;
+    char defaultSizes[] = DEFAULT_SIZES;
+    char *sizeList = defaultSizes;
+    static struct option long_options[] =
+        {
+            {"structures", required_argument, 0, 'S'},
+            {"patterns",   required_argument, 0, 'p'},
+            {"bytes",      required_argument, 0, 'b'},
+            {"density",    required_argument, 0, 'd'},
+            {"nops",       required_argument, 0, 'n'},
+            {"warmup",     required_argument, 0, 'w'},
+            {"seed",       required_argument, 0, 's'},
+            {"help",       no_argument,       0, 'h'},
+            {"verbose",    no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "S:p:b:d:n:w:s:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 'S':
+            if (!parseNames(optarg, STRUCTURE_NAMES, NSTRUCTURES, structures, argv[0]))
+                return 1;
+            break;
+        case 'p':
+            if (!parseNames(optarg, PATTERN_NAMES, NPATTERNS, patterns, argv[0]))
+                return 1;
+            break;
+        case 'b':
+            sizeList = optarg; break;
+        case 'd':
+            density = atof(optarg);
+            if (density <= 0 || density >= 1)
+            {
+                cerr << argv[0] << ": argument of -d,--density must be between 0 and 1" << endl;
+                return 1;
+            }
+            break;
+        case 'n':
+            nops = atol(optarg);
+            if (nops == 0)
+            {
+                cerr << argv[0] << ": argument of -n,--nops must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 'w':
+            nwarmup = atol(optarg); break;
+        case 's':
+            seed = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+    for (char *size = strtok(sizeList, ","); size; size = strtok(0, ","))
+    {
+        unsigned b = atoi(size);
+        if (b < 10 || b > 34)
+        {
+            cerr << argv[0] << ": sizes of -b,--bytes must be between 10 and 34" << endl;
+            return 1;
+        }
+        sizes.push_back(b);
+    }
+    if (structures.empty())
+        for (unsigned t = 0; t < NSTRUCTURES; ++t)
+            structures.push_back(t);
+    if (patterns.empty())
+        for (unsigned t = 0; t < NPATTERNS; ++t)
+            patterns.push_back(t);
+
+    // Parse filename
+    if (argc - optind > 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    srand(seed);
+    vector<ulong> x;
+    volatile ulong checksum = 0; // Keeps the compiler from dropping the operations
+    fprintf(output, "#structure\toperation\tpattern\tbytes\tn\tns_per_op\n");
+    for (vector<unsigned>::const_iterator s = structures.begin(); s != structures.end(); ++s)
+        for (vector<unsigned>::const_iterator b = sizes.begin(); b != sizes.end(); ++b)
+        {
+            ulong bytes = 1lu << *b;
+            // libcds bit vectors have 32-bit lengths
+            if (*s == BRW32 && bytes * 8 > ~0u)
+            {
+                if (verbose) cerr << "Skipping " << STRUCTURE_NAMES[*s] << " of 2^" << *b << " bytes" << endl;
+                continue;
+            }
+            if (verbose) cerr << "Building " << STRUCTURE_NAMES[*s] << " of 2^" << *b << " bytes" << endl;
+            PrimitiveBench *bench = makeBench((structure_type)*s, bytes, density);
+            for (unsigned op = 0; op < bench->operations(); ++op)
+                for (vector<unsigned>::const_iterator p = patterns.begin(); p != patterns.end(); ++p)
+                {
+                    if (bench->domain(op) == 0)
+                        continue;
+                    // Warm-up and measurement use different arguments
+                    generateArguments(x, nwarmup + nops, bench->first(op), bench->domain(op), (access_pattern)*p);
+                    checksum += bench->run(op, &x[0], nwarmup);
+
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    checksum += bench->run(op, &x[nwarmup], nops);
+                    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                    fprintf(output, "%s\t%s\t%s\t%lu\t%lu\t%.2f\n", STRUCTURE_NAMES[*s], bench->operationName(op),
+                            PATTERN_NAMES[*p], bytes, bench->length(), ns / nops);
+                    fflush(output);
+                }
+            delete bench;
+        }
+
+    if (verbose)
+        cerr << "Checksum " << checksum << endl;
+    if (!ToolCommon::CloseOutput(output))
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        return 1;
+    }
+    return 0;
+}
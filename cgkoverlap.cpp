@@ -0,0 +1,278 @@
+/**
+ * Read-overlap candidates via shared k-mers
+ *
+ * Reports all pairs of reads that share at least t distinct k-mers.
+ * Each distinct k-mer (run of B_lcp, see enumerateKmers()) is processed
+ * once: its reads are reported, and every pair of them is scattered into
+ * a bucket by the smaller read number. The buckets are then sorted and
+ * aggregated independently. Both phases are distributed across threads.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
+
+#include "CGkArray.h"
+#include "ToolCommon.h"
+
+using namespace std;
+
+#define DEFAULT_MIN_SHARED 2
+#define DEFAULT_MAX_READS 1000
+#define DEFAULT_CHUNKSIZE (1lu << 20)
+#define NBUCKETS 1024
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl << endl
+         << "Reports all pairs of reads in <index> that share at least t distinct k-mers." << endl
+         << "If no output filename is given, the pairs are written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -m <int>, --min-shared <int>  Minimum number of shared k-mers t (default: " << DEFAULT_MIN_SHARED << ")." << endl
+         << " -x <int>, --max-reads <int>   Skip k-mers that occur in more reads, e.g. repeats;" << endl
+         << "                               0 means no limit (default: " << DEFAULT_MAX_READS << ")." << endl
+         << " -k <int>, --gk <int>          k-mer length, for indexes with several k (default: first)." << endl
+         << " -c <int>, --chunk-size <int>  Number of suffixes per work unit (default: " << DEFAULT_CHUNKSIZE << ")." << endl
+#ifdef PARALLEL_SUPPORT
+         << " -t <int>, --threads <int>     Number of threads, 0 uses all cores (default: 0)." << endl
+#endif
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "Each output line has two read numbers a < b and the number of k-mers" << endl
+         << "they share, separated by tabs, sorted by a and then b." << endl;
+}
+
+// Read pair (a, b) with a < b, packed as a << 32 | b
+typedef unsigned long long read_pair;
+typedef vector<read_pair> pair_bucket;
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    if (argc <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool verbose = false;
+    unsigned minShared = DEFAULT_MIN_SHARED;
+    unsigned maxReads = DEFAULT_MAX_READS;
+    unsigned k = 0;
+    ulong chunksize = DEFAULT_CHUNKSIZE;
+    unsigned parallel = 0;
+    static struct option long_options[] =
+        {
+            {"min-shared", required_argument, 0, 'm'},
+            {"max-reads",  required_argument, 0, 'x'},
+            {"gk",         required_argument, 0, 'k'},
+            {"chunk-size", required_argument, 0, 'c'},
+            {"threads",    required_argument, 0, 't'},
+            {"help",       no_argument,       0, 'h'},
+            {"verbose",    no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "m:x:k:c:t:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 'm':
+            minShared = atoi(optarg);
+            if (minShared == 0)
+            {
+                cerr << argv[0] << ": argument of -m,--min-shared must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 'x':
+            maxReads = atoi(optarg); break;
+        case 'k':
+            k = atoi(optarg); break;
+        case 'c':
+            chunksize = atol(optarg);
+            if (chunksize == 0)
+            {
+                cerr << argv[0] << ": argument of -c,--chunk-size must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 't':
+            parallel = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+
+    // Parse filenames
+    if (argc - optind < 1 || argc - optind > 2)
+    {
+        cerr << argv[0] << ": index filename is required" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexfile = string(argv[optind++]);
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    if (verbose) cerr << "Loading index " << indexfile << endl;
+    CGkArray *tc = new CGkArray(indexfile);
+    if (k == 0)
+        k = tc->getGkSize();
+    vector<unsigned> ks = tc->getGkSizes();
+    if (std::find(ks.begin(), ks.end(), k) == ks.end())
+    {
+        cerr << argv[0] << ": k-mer length " << k << " was not indexed" << endl;
+        delete tc;
+        return 1;
+    }
+
+    unsigned nthreads = ToolCommon::SetThreads(argv[0], parallel, verbose);
+
+    time_t wctime = time(NULL);
+    ulong n = tc->getLength();
+    unsigned nreads = tc->getNumberOfReads();
+    long nchunks = (n + chunksize - 1) / chunksize;
+    // Buckets of each thread, bucket i holds the pairs whose smaller
+    // read number falls into the i'th slice of the read numbers
+    vector<vector<pair_bucket> > buckets(nthreads, vector<pair_bucket>(NBUCKETS));
+    ulong skipped = 0;
+
+    /**
+     * Scatter the read pairs of each distinct k-mer into buckets
+     */
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel reduction(+:skipped)
+#endif
+    {
+#ifdef PARALLEL_SUPPORT
+        vector<pair_bucket> &local = buckets[omp_get_thread_num()];
+#else
+        vector<pair_bucket> &local = buckets[0];
+#endif
+        CGkArray::kmer_class_vector kmers;
+        vector<unsigned> reads;
+#ifdef PARALLEL_SUPPORT
+#pragma omp for schedule(dynamic, 1)
+#endif
+        for (long chunk = 0; chunk < nchunks; ++chunk)
+        {
+            kmers.clear();
+            tc->enumerateKmers(chunk * chunksize, (chunk + 1) * chunksize - 1, kmers, k);
+            for (CGkArray::kmer_class_vector::const_iterator it = kmers.begin(); it != kmers.end(); ++it)
+            {
+                if (it->second < 2)
+                    continue;
+                if (maxReads && it->second > maxReads)
+                {
+                    ++skipped;
+                    continue;
+                }
+                // Each read is reported once per k-mer
+                CGkArray::position_vector pv = tc->reportReads(it->first, k);
+                reads.clear();
+                for (CGkArray::position_vector::const_iterator jt = pv.begin(); jt != pv.end(); ++jt)
+                    reads.push_back(jt->first);
+                std::sort(reads.begin(), reads.end());
+                for (vector<unsigned>::const_iterator a = reads.begin(); a != reads.end(); ++a)
+                {
+                    pair_bucket &bucket = local[(ulong)*a * NBUCKETS / nreads];
+                    for (vector<unsigned>::const_iterator b = a + 1; b != reads.end(); ++b)
+                        bucket.push_back((read_pair)*a << 32 | *b);
+                }
+            }
+        }
+    }
+    if (verbose)
+        cerr << "Scatter phase done, " << skipped << " k-mers skipped. Wall-clock time: "
+             << std::difftime(time(NULL), wctime) << " s." << endl;
+
+    /**
+     * Aggregate each bucket and write the pairs in bucket order
+     */
+    ulong npairs = 0;
+    bool failed = false;
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel reduction(+:npairs)
+#endif
+    {
+        pair_bucket pairs;
+        vector<char> buffer;
+#ifdef PARALLEL_SUPPORT
+#pragma omp for ordered schedule(dynamic, 1)
+#endif
+        for (long i = 0; i < NBUCKETS; ++i)
+        {
+            pairs.clear();
+            for (unsigned t = 0; t < nthreads; ++t)
+            {
+                pair_bucket &b = buckets[t][i];
+                pairs.insert(pairs.end(), b.begin(), b.end());
+                pair_bucket().swap(b); // Release memory
+            }
+            std::sort(pairs.begin(), pairs.end());
+            for (pair_bucket::const_iterator it = pairs.begin(); it != pairs.end(); )
+            {
+                pair_bucket::const_iterator jt = it;
+                while (jt != pairs.end() && *jt == *it)
+                    ++jt;
+                if ((unsigned)(jt - it) >= minShared)
+                {
+                    char tmp[64];
+                    int l = snprintf(tmp, sizeof(tmp), "%u\t%u\t%u\n",
+                                     (unsigned)(*it >> 32), (unsigned)(*it & 0xfffffffflu), (unsigned)(jt - it));
+                    buffer.insert(buffer.end(), tmp, tmp + l);
+                    ++npairs;
+                }
+                it = jt;
+            }
+#ifdef PARALLEL_SUPPORT
+#pragma omp ordered
+#endif
+            {
+                if (!ToolCommon::WriteBuffer(output, buffer))
+                    failed = true;
+            }
+        }
+    }
+
+    if (!ToolCommon::CloseOutput(output))
+        failed = true;
+    if (failed)
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        delete tc;
+        return 1;
+    }
+    if (verbose)
+        cerr << npairs << " read pairs share at least " << minShared << " " << k << "-mers. Wall-clock time: "
+             << std::difftime(time(NULL), wctime) << " s." << endl;
+    delete tc;
+    return 0;
+}
@@ -8,13 +8,97 @@ using std::string;
 #include <ctime>
 #include <cstring>
 #include <getopt.h>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
 
 #include "CGkArray.h"
+#include "PerfCounters.h"
 
 void print_usage(char const *name)
 {
     cerr << "usage: " << name << " [options] <index>" << endl
-         << "Sample program to test out CGkArrays. Check README for more information." << endl;
+         << "Sample program to test out CGkArrays. Check README for more information." << endl
+         << "Options: -q <int> random queries, -T <int> most frequent k-mers (-R ranks by reads)," << endl
+#ifdef PARALLEL_SUPPORT
+         << "         -t <int> threads (0 uses all cores), -D debug, -v verbose." << endl;
+#else
+         << "         -D debug, -v verbose." << endl;
+#endif
+}
+
+/**
+ * Print the N most frequent k-mers and their frequency
+ *
+ * The suffix array is scanned in chunks, each thread keeps its own 
+ * top N and the per-thread results are merged at the end.
+ */
+void printTopKmers(CGkArray const *tc, unsigned N, CGkArray::kmer_order order)
+{
+    const ulong chunksize = 1lu << 20;
+    long nchunks = (tc->getLength() + chunksize - 1) / chunksize;
+    CGkArray::kmer_class_vector top;
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel
+#endif
+    {
+        CGkArray::kmer_class_vector local;
+#ifdef PARALLEL_SUPPORT
+#pragma omp for schedule(dynamic, 1)
+#endif
+        for (long chunk = 0; chunk < nchunks; ++chunk)
+            CGkArray::mergeTopKmers(local, tc->topKmers(N, order, 0, chunk * chunksize, (chunk + 1) * chunksize - 1), 
+                                    N, order);
+#ifdef PARALLEL_SUPPORT
+#pragma omp critical
+#endif
+        CGkArray::mergeTopKmers(top, local, N, order);
+    }
+
+    for (CGkArray::kmer_class_vector::const_iterator it = top.begin(); it != top.end(); ++it)
+    {
+        uchar *kmer = tc->getSuffix(it->first.first, tc->getGkSize());
+        cout << kmer << "\t" << (order == CGkArray::by_reads ? it->second : tc->countOccs(it->first)) << endl;
+        delete [] kmer;
+    }
+}
+
+/**
+ * Print the hardware counters per query, if any are available
+ */
+void printCounters(PerfCounters const &counters, unsigned nqueries)
+{
+    if (!counters.anyAvailable())
+        return;
+    cerr << "Hardware counters per query:";
+    for (unsigned e = 0; e < PerfCounters::NEVENTS; ++e)
+    {
+        PerfCounters::event ev = (PerfCounters::event)e;
+        cerr << " " << PerfCounters::NAMES[e] << " ";
+        if (counters.available(ev))
+            cerr << (double)counters.value(ev) / nqueries;
+        else
+            cerr << "NA";
+    }
+    cerr << endl;
+}
+
+/**
+ * Print the operation counts per query, if compiled with -DQUERY_STATS
+ */
+void printQueryStats(unsigned nqueries)
+{
+    if (!CGkArray::queryStatsEnabled())
+        return;
+    CGkArray::query_stats qs = CGkArray::getQueryStats();
+    cerr << "Operations per query: LF steps " << (double)qs.lfSteps / nqueries
+         << ", rank " << (double)qs.rankCalls / nqueries
+         << ", access " << (double)qs.accessCalls / nqueries
+         << ", select " << (double)qs.selectCalls / nqueries
+         << ", prev/next " << (double)qs.bitvectorCalls / nqueries
+         << ", locates " << (double)qs.locates / nqueries
+         << " (mean walk " << (qs.locates ? (double)qs.locateSteps / qs.locates : 0)
+         << ", max " << qs.maxLocateSteps << ")" << endl;
 }
 
 // FIXME Clean up. Use for debugging only.
@@ -66,24 +150,40 @@ int main(int argc, char **argv)
     bool verbose = false; 
     bool debug = false;
     unsigned nqueries = 0;
+    unsigned ntop = 0;
+    bool topByReads = false;
 #ifdef PARALLEL_SUPPORT
     unsigned parallel = 1; /* Disabled for this simple example */
 #endif
     static struct option long_options[] =
         {
             {"nqueries",  required_argument, 0, 'q'},
+            {"top",       required_argument, 0, 'T'},
+            {"by-reads",  no_argument,       0, 'R'},
+            {"threads",   required_argument, 0, 't'},
             {"debug",     no_argument,       0, 'D'},
             {"verbose",   no_argument,       0, 'v'},
             {0, 0, 0, 0}
         };
     int option_index = 0;
     int c;
-    while ((c = getopt_long(argc, argv, "q:Dv", long_options, &option_index)) != -1) 
+    while ((c = getopt_long(argc, argv, "q:T:Rt:Dv", long_options, &option_index)) != -1) 
     {
         switch(c) 
         {
         case 'q':
             nqueries = atoi(optarg); break;
+        case 'T':
+            ntop = atoi(optarg); break;
+        case 'R':
+            topByReads = true; break;
+        case 't':
+#ifdef PARALLEL_SUPPORT
+            parallel = atoi(optarg);
+#else
+            cerr << argv[0] << ": warning: compiled without parallel support, ignoring -t" << endl;
+#endif
+            break;
         case 'v':
             verbose = true; break;
         case 'D':
@@ -107,7 +207,7 @@ int main(int argc, char **argv)
     }
     string indexfile = string(argv[optind++]);
 
-    if (nqueries < 1) 
+    if (nqueries < 1 && ntop < 1) 
     {
         cerr << argv[0] << ": parameter -q,--nqueries <int> is mandatory, where <int> is greater than 0." << endl;
         print_usage(argv[0]);
@@ -155,6 +255,18 @@ int main(int argc, char **argv)
 /* #pragma omp parallel */
 #endif
 
+    if (ntop)
+    {
+        printTopKmers(tc, ntop, topByReads ? CGkArray::by_reads : CGkArray::by_occs);
+        if (verbose)
+            cerr << "Top " << ntop << " k-mers done. Wall-clock time: " << std::difftime(time(NULL), wctime) << " s." << endl;
+        if (nqueries < 1)
+        {
+            delete tc;
+            return 0;
+        }
+    }
+
     /**
      * Example on how to compute a so called read-coverage profile
      *
@@ -213,12 +325,19 @@ int main(int argc, char **argv)
     }
 
 
+    PerfCounters counters;
+    if (PerfCounters::compiledIn() && !counters.anyAvailable())
+        cerr << argv[0] << ": warning: hardware counters are not available" << endl;
+
     /**
      * Test random positions
      */
     srand(543262346);
     wctime = time(NULL);
     cerr << "Testing " << nqueries << " random positions for Q1..." << endl;
+    CGkArray::resetQueryStats();
+    counters.reset();
+    counters.start();
     for (unsigned i = 0; i < nqueries; ++i)
     {
         ulong pos = rand() % tc->getLength();
@@ -244,16 +363,22 @@ int main(int argc, char **argv)
             ++total_found;
         total_occs += occs.size();
     }
+    counters.stop();
     cerr << "Number of reported alignments: " << total_occs << endl
          << "Number of reads found: " << total_found << endl;
     cerr << "Wall-clock time: " << std::difftime(time(NULL), wctime) << " seconds (" 
          << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
+    printCounters(counters, nqueries);
+    printQueryStats(nqueries);
 
 
     srand(543262346);    
     cerr << "Testing " << nqueries << " random positions for Q2..." << endl;
     total_found = 0;
     wctime = time(NULL);
+    CGkArray::resetQueryStats();
+    counters.reset();
+    counters.start();
     total_occs = 0;
     for (unsigned i = 0; i < nqueries; ++i)
     {
@@ -278,16 +403,22 @@ int main(int argc, char **argv)
             ++total_found;
         total_occs += occs;
     }
+    counters.stop();
     cerr << "Number of reported alignments: " << total_occs << endl
          << "Number of reads found: " << total_found << endl;
     cerr << "Wall-clock time: " << std::difftime(time(NULL), wctime) << " seconds (" 
          << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
+    printCounters(counters, nqueries);
+    printQueryStats(nqueries);
 
 
     srand(543262346);    
     cerr << "Testing " << nqueries << " random positions for Q3..." << endl;
     total_found = 0;
     wctime = time(NULL);
+    CGkArray::resetQueryStats();
+    counters.reset();
+    counters.start();
     total_occs = 0;
     for (unsigned i = 0; i < nqueries; ++i)
     {
@@ -313,16 +444,22 @@ int main(int argc, char **argv)
             ++total_found;
         total_occs += occs.size();
     }
+    counters.stop();
     cerr << "Number of reported alignments: " << total_occs << endl
          << "Number of reads found: " << total_found << endl;
     cerr << "Wall-clock time: " << std::difftime(time(NULL), wctime) << " seconds (" 
          << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
+    printCounters(counters, nqueries);
+    printQueryStats(nqueries);
 
 
     srand(543262346);    
     cerr << "Testing " << nqueries << " random positions for Q4..." << endl;
     total_found = 0;
     wctime = time(NULL);
+    CGkArray::resetQueryStats();
+    counters.reset();
+    counters.start();
     total_occs = 0;
     for (unsigned i = 0; i < nqueries; ++i)
     {
@@ -347,10 +484,13 @@ int main(int argc, char **argv)
             ++total_found;
         total_occs += occs;
     }
+    counters.stop();
     cerr << "Number of reported alignments: " << total_occs << endl
          << "Number of reads found: " << total_found << endl;
     cerr << "Wall-clock time: " << std::difftime(time(NULL), wctime) << " seconds (" 
          << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
+    printCounters(counters, nqueries);
+    printQueryStats(nqueries);
 
     delete tc;
 }
@@ -0,0 +1,221 @@
+/**
+ * k-mer spectrum of the index
+ *
+ * Enumerates the distinct k-mers (the runs of B_lcp, see enumerateKmers())
+ * and writes the k-mer abundance histogram, or optionally every distinct
+ * k-mer with its number of occurrences and reads. The suffix array is
+ * split into chunks that are distributed across threads.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <getopt.h>
+
+#include "CGkArray.h"
+#include "ToolCommon.h"
+
+using namespace std;
+
+#define DEFAULT_CHUNKSIZE (1lu << 20)
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index> [output]" << endl << endl
+         << "Computes the k-mer abundance histogram of <index>." << endl
+         << "If no output filename is given, the output is written to stdout." << endl << endl
+         << "Options:" << endl
+         << " -r, --reads                   Abundance is the number of reads (default: occurrences)." << endl
+         << " -d, --dump                    Write each distinct k-mer instead of the histogram." << endl
+         << " -k <int>, --gk <int>          k-mer length, for indexes with several k (default: first)." << endl
+         << " -c <int>, --chunk-size <int>  Number of suffixes per work unit (default: " << DEFAULT_CHUNKSIZE << ")." << endl
+#ifdef PARALLEL_SUPPORT
+         << " -t <int>, --threads <int>     Number of threads, 0 uses all cores (default: 0)." << endl
+#endif
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl << endl
+         << "The histogram has one line per abundance: the abundance followed by" << endl
+         << "the number of distinct k-mers, separated by a tab." << endl
+         << "With -d, each line has a k-mer, its number of occurrences and its number" << endl
+         << "of reads, separated by tabs, in lexicographic order." << endl;
+}
+
+typedef map<ulong, ulong> histogram;
+
+int main(int argc, char **argv)
+{
+    /**
+     * Parse command line parameters
+     */
+    if (argc <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool verbose = false;
+    bool byReads = false;
+    bool dump = false;
+    unsigned k = 0;
+    ulong chunksize = DEFAULT_CHUNKSIZE;
+    unsigned parallel = 0;
+    static struct option long_options[] =
+        {
+            {"reads",      no_argument,       0, 'r'},
+            {"dump",       no_argument,       0, 'd'},
+            {"gk",         required_argument, 0, 'k'},
+            {"chunk-size", required_argument, 0, 'c'},
+            {"threads",    required_argument, 0, 't'},
+            {"help",       no_argument,       0, 'h'},
+            {"verbose",    no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "rdk:c:t:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 'r':
+            byReads = true; break;
+        case 'd':
+            dump = true; break;
+        case 'k':
+            k = atoi(optarg); break;
+        case 'c':
+            chunksize = atol(optarg);
+            if (chunksize == 0)
+            {
+                cerr << argv[0] << ": argument of -c,--chunk-size must be greater than 0" << endl;
+                return 1;
+            }
+            break;
+        case 't':
+            parallel = atoi(optarg); break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true; break;
+        case '?':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            std::abort ();
+        }
+    }
+
+    // Parse filenames
+    if (argc - optind < 1 || argc - optind > 2)
+    {
+        cerr << argv[0] << ": index filename is required" << endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexfile = string(argv[optind++]);
+    FILE *output = ToolCommon::OpenOutput(argv[0], optind != argc ? argv[optind] : 0);
+    if (!output)
+        return 1;
+
+    if (verbose) cerr << "Loading index " << indexfile << endl;
+    CGkArray *tc = new CGkArray(indexfile);
+    if (k == 0)
+        k = tc->getGkSize();
+    vector<unsigned> ks = tc->getGkSizes();
+    if (std::find(ks.begin(), ks.end(), k) == ks.end())
+    {
+        cerr << argv[0] << ": k-mer length " << k << " was not indexed" << endl;
+        delete tc;
+        return 1;
+    }
+
+    ToolCommon::SetThreads(argv[0], parallel, verbose);
+
+    time_t wctime = time(NULL);
+    ulong n = tc->getLength();
+    long nchunks = (n + chunksize - 1) / chunksize;
+    histogram total;
+    ulong distinct = 0;
+    bool failed = false;
+#ifdef PARALLEL_SUPPORT
+#pragma omp parallel
+#endif
+    {
+        histogram local;
+        CGkArray::kmer_class_vector kmers;
+        vector<char> buffer;
+#ifdef PARALLEL_SUPPORT
+#pragma omp for ordered schedule(dynamic, 1)
+#endif
+        for (long chunk = 0; chunk < nchunks; ++chunk)
+        {
+            kmers.clear();
+            tc->enumerateKmers(chunk * chunksize, (chunk + 1) * chunksize - 1, kmers, k);
+            for (CGkArray::kmer_class_vector::const_iterator it = kmers.begin(); it != kmers.end(); ++it)
+            {
+                ulong occs = tc->countOccs(it->first);
+                if (!dump)
+                {
+                    ++local[byReads ? it->second : occs];
+                    continue;
+                }
+                uchar *kmer = tc->getSuffix(it->first.first, k);
+                char tmp[64];
+                buffer.insert(buffer.end(), kmer, kmer + k);
+                int l = snprintf(tmp, sizeof(tmp), "\t%lu\t%u\n", occs, it->second);
+                buffer.insert(buffer.end(), tmp, tmp + l);
+                delete [] kmer;
+            }
+#ifdef PARALLEL_SUPPORT
+#pragma omp ordered
+#endif
+            {
+                if (!ToolCommon::WriteBuffer(output, buffer))
+                    failed = true;
+            }
+        }
+#ifdef PARALLEL_SUPPORT
+#pragma omp critical
+#endif
+        {
+            for (histogram::const_iterator it = local.begin(); it != local.end(); ++it)
+            {
+                total[it->first] += it->second;
+                distinct += it->second;
+            }
+        }
+    }
+
+    for (histogram::const_iterator it = total.begin(); it != total.end() && !failed; ++it)
+        if (fprintf(output, "%lu\t%lu\n", it->first, it->second) < 0)
+            failed = true;
+
+    if (!ToolCommon::CloseOutput(output))
+        failed = true;
+    if (failed)
+    {
+        cerr << argv[0] << ": file write error" << endl;
+        delete tc;
+        return 1;
+    }
+    if (verbose)
+    {
+        if (!dump)
+            cerr << distinct << " distinct " << k << "-mers. ";
+        cerr << "Wall-clock time: " << std::difftime(time(NULL), wctime) << " s." << endl;
+    }
+    delete tc;
+    return 0;
+}
@@ -1,18 +1,91 @@
 BitRank.o: BitRank.cpp BitRank.h Tools.h
-CGkArray.o: CGkArray.cpp CGkArray.h BlockArray.h Tools.h ArrayDoc.h \
- HuffWT.h BitRank.h rlcsa/bits/deltavector.h rlcsa/bits/bitvector.h \
- rlcsa/bits/../misc/definitions.h rlcsa/bits/bitbuffer.h \
- libcds/includes/basics.h libcds/includes/static_bitsequence.h \
+BlockArray.o: BlockArray.cpp BlockArray.h Tools.h
+CGkArray.o: CGkArray.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
  libcds/includes/static_bitsequence_rrr02.h \
  libcds/includes/table_offset.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
- libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h
-HuffWT.o: HuffWT.cpp HuffWT.h BitRank.h Tools.h
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h
+HuffWT.o: HuffWT.cpp HuffWT.h Tools.h QueryStats.h
+PackedText.o: PackedText.cpp PackedText.h Tools.h ReadBoundary.h \
+ rlcsa/bits/deltavector.h rlcsa/bits/bitvector.h \
+ rlcsa/bits/../misc/definitions.h rlcsa/bits/bitbuffer.h
+PerfCounters.o: PerfCounters.cpp PerfCounters.h Tools.h
+ReadBoundary.o: ReadBoundary.cpp ReadBoundary.h Tools.h \
+ rlcsa/bits/deltavector.h rlcsa/bits/bitvector.h \
+ rlcsa/bits/../misc/definitions.h rlcsa/bits/bitbuffer.h
+ToolCommon.o: ToolCommon.cpp ToolCommon.h
 Tools.o: Tools.cpp Tools.h
 builder.o: builder.cpp bcr-demo.h CGkArray.h BlockArray.h Tools.h \
- ArrayDoc.h HuffWT.h BitRank.h rlcsa/bits/deltavector.h \
+ HuffWT.h QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h PackedText.h
+cgkbench.o: cgkbench.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
  rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
  rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
  libcds/includes/static_bitsequence.h \
@@ -21,9 +94,147 @@ builder.o: builder.cpp bcr-demo.h CGkArray.h BlockArray.h Tools.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
- libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h
-cgkquery.o: cgkquery.cpp CGkArray.h BlockArray.h Tools.h ArrayDoc.h \
- HuffWT.h BitRank.h rlcsa/bits/deltavector.h rlcsa/bits/bitvector.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h PerfCounters.h
+cgkcorrect.o: cgkcorrect.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h
+cgkcoverage.o: cgkcoverage.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h
+cgkdiff.o: cgkdiff.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h
+cgkmicrobench.o: cgkmicrobench.cpp BitRank.h Tools.h CGkArray.h \
+ BlockArray.h HuffWT.h QueryStats.h ReadBoundary.h \
+ rlcsa/bits/deltavector.h rlcsa/bits/bitvector.h \
  rlcsa/bits/../misc/definitions.h rlcsa/bits/bitbuffer.h \
  libcds/includes/basics.h libcds/includes/static_bitsequence.h \
  libcds/includes/static_bitsequence_rrr02.h \
@@ -31,4 +242,141 @@ cgkquery.o: cgkquery.cpp CGkArray.h BlockArray.h Tools.h ArrayDoc.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
- libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h
+cgkoverlap.o: cgkoverlap.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h
+cgkquery.o: cgkquery.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h PerfCounters.h
+cgkspectrum.o: cgkspectrum.cpp CGkArray.h BlockArray.h Tools.h HuffWT.h \
+ QueryStats.h ReadBoundary.h rlcsa/bits/deltavector.h \
+ rlcsa/bits/bitvector.h rlcsa/bits/../misc/definitions.h \
+ rlcsa/bits/bitbuffer.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ libcds/includes/static_bitsequence_builder.h \
+ libcds/includes/static_bitsequence_builder_rrr02.h \
+ libcds/includes/static_bitsequence_builder_rrr02_light.h \
+ libcds/includes/static_bitsequence_builder_brw32.h \
+ libcds/includes/static_bitsequence_builder_sdarray.h ArrayDoc.h \
+ libcds/includes/static_sequence_wvtree_noptrs.h \
+ libcds/includes/static_sequence.h \
+ libcds/includes/static_sequence_wvtree.h \
+ libcds/includes/wt_node_internal.h libcds/includes/wt_node.h \
+ libcds/includes/wt_coder.h libcds/includes/wt_coder_huff.h \
+ libcds/includes/huffman_codes.h libcds/includes/huff.h \
+ libcds/includes/alphabet_mapper.h libcds/includes/alphabet_mapper_none.h \
+ libcds/includes/alphabet_mapper_cont.h libcds/includes/wt_coder_binary.h \
+ libcds/includes/wt_node_leaf.h \
+ libcds/includes/static_sequence_gmr_chunk.h \
+ libcds/includes/static_permutation.h \
+ libcds/includes/static_permutation_mrrr.h libcds/includes/perm.h \
+ libcds/includes/static_permutation_builder.h \
+ libcds/includes/static_permutation_builder_mrrr.h \
+ libcds/includes/static_sequence_gmr.h \
+ libcds/includes/static_sequence_builder.h \
+ libcds/includes/static_sequence_builder_wvtree.h \
+ libcds/includes/static_sequence_builder_wvtree_noptrs.h \
+ libcds/includes/static_sequence_builder_gmr.h \
+ libcds/includes/static_sequence_builder_gmr_chunk.h \
+ libcds/includes/static_sequence_bs.h ToolCommon.h
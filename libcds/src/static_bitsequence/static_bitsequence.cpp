@@ -86,6 +86,20 @@ uint static_bitsequence::select_next0(uint i) {
 	return select0(rank0(i)+1);
 }
 
+uint static_bitsequence::prev(uint i) {
+  if(i>=len) i = len-1;
+  uint r = rank1(i);
+  if(r==0) return (uint)-1;
+  return select1(r);
+}
+
+uint static_bitsequence::next(uint i) {
+  if(i>=len) return len;
+  uint r = (i==0)?0:rank1(i-1);
+  if(r>=ones) return len;
+  return select1(r+1);
+}
+
 bool static_bitsequence::access(uint i) {
   return (rank1(i)-(i!=0?rank1(i-1):0))>0;
 }
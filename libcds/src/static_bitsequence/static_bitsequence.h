@@ -61,6 +61,14 @@ public:
 	virtual uint select_next1(uint i);
 	virtual uint select_next0(uint i);
 
+	/** Returns the largest position j<=i such that the j-th bit is set
+	 * @return (uint)-1 if there is no such position */
+  virtual uint prev(uint i);
+
+	/** Returns the smallest position j>=i such that the j-th bit is set
+	 * @return len if there is no such position */
+  virtual uint next(uint i);
+
 	/** Returns the i-th bit */
   virtual bool access(uint i);
 
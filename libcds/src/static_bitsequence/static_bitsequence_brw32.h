@@ -61,9 +61,9 @@ public:
   virtual bool access(uint i);
   virtual uint rank1(uint i); //Nivel 1 bin, nivel 2 sec-pop y nivel 3 sec-bit
 
-  uint prev(uint start); // gives the largest index i<=start such that IsBitSet(i)=true
+  virtual uint prev(uint start); // gives the largest index i<=start such that IsBitSet(i)=true
   uint prev2(uint start); // gives the largest index i<=start such that IsBitSet(i)=true
-  uint next(uint start); // gives the smallest index i>=start such that IsBitSet(i)=true
+  virtual uint next(uint start); // gives the smallest index i>=start such that IsBitSet(i)=true
   virtual uint select0(uint x); // gives the position of the x:th 1.
   virtual uint select1(uint x); // gives the position of the x:th 1.
   uint SpaceRequirementInBits();
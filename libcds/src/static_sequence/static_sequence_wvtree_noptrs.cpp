@@ -413,6 +413,52 @@ uint static_sequence_wvtree_noptrs::count(uint i, uint j, uint min, uint max, ui
 }
 
 
+uint static_sequence_wvtree_noptrs::rangeCount(uint i, uint j, uint min, uint max)
+{
+    if (j < i || max < min)
+        return 0;
+    return rangeCount(i, j, am->map(min), am->map(max), 0, 0, 0, n-1);
+}
+
+uint static_sequence_wvtree_noptrs::rangeCount(uint i, uint j, uint min, uint max, uint l, uint pivot, uint start, uint end)
+{
+    if (j < i || max < min || end < start)
+        return 0;
+    // All values of the node are in [min, max]
+    if (min <= pivot && (pivot | ((1u << (height-l)) - 1)) <= max)
+        return j - i + 1;
+    if (l == height)
+        return 0;
+
+    uint symbol = pivot | (1 << (height-l-1));
+    uint result = 0;
+    if (min < symbol)
+    {
+        // Recurse left
+        uint newi = i + bitstring[l]->rank1(start-1) - bitstring[l]->rank1(i-1);
+        uint newend = end - (bitstring[l]->rank1(end) - bitstring[l]->rank1(start-1));
+        uint newj = j + bitstring[l]->rank1(start-1) - bitstring[l]->rank1(j) + 1;
+
+        uint newmax = max < symbol - 1 ? max : symbol - 1;
+        if (newj > start)
+            result += rangeCount(newi, newj-1, min, newmax, l+1, pivot, start, newend);
+    }
+
+    if (max >= symbol)
+    {
+        // Recurse right
+        uint newstart = (bitstring[l]->rank1(end)-bitstring[l]->rank1(start-1));
+        newstart = end - newstart + 1;
+        uint newi = bitstring[l]->rank1(i-1)-bitstring[l]->rank1(start-1) + newstart;
+        uint newj = bitstring[l]->rank1(j)-bitstring[l]->rank1(start-1) + newstart;
+
+        uint newmin = min > symbol ? min : symbol;
+        if (newj > newstart)
+            result += rangeCount(newi, newj-1, newmin, max, l+1, symbol, newstart, end);
+    }
+    return result;
+}
+
 
 inline uint get_start(uint symbol, uint mask) {
   return symbol&mask;
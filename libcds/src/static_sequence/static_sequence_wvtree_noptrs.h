@@ -54,6 +54,10 @@ class static_sequence_wvtree_noptrs : public static_sequence {
     virtual vector<int> access(uint i, uint j, uint min, uint max);
     virtual vector<int> accessAll(uint i, uint j);
     virtual uint count(uint i, uint j, uint min, uint max);
+    /** Number of positions in [i, j] whose value is in [min, max]; unlike
+     * count() above, which counts the distinct values, this takes time
+     * logarithmic in the alphabet size. */
+    uint rangeCount(uint i, uint j, uint min, uint max);
     
     virtual uint save(FILE *fp);
     static static_sequence_wvtree_noptrs * load(FILE *fp);
@@ -62,6 +66,7 @@ class static_sequence_wvtree_noptrs : public static_sequence {
     void access(vector<int> &result, uint i, uint j, uint min, uint max, uint l, uint pivot, uint start, uint end);
     void accessAll(vector<int> &result, uint i, uint j, uint l, uint pivot, uint start, uint end);
     uint count(uint i, uint j, uint min, uint max, uint l, uint pivot, uint start, uint end);
+    uint rangeCount(uint i, uint j, uint min, uint max, uint l, uint pivot, uint start, uint end);
 
     static_sequence_wvtree_noptrs();
     